@@ -31,7 +31,7 @@ int main(int argc, char** argv)
     // init main window and engine
     tk::init("tk", 200, 200);
 
-    tk::load_fonts(
+    tk::load_fonts_async(
     { 
       "assets/NotoSansJP-Regular.ttf",
       "assets/NotoSansSC-Regular.ttf",
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <string_view>
+#include <functional>
 
 #include <glm/glm.hpp>
 
@@ -19,8 +20,10 @@ namespace tk
    * @param title title of main window
    * @param width width of main window
    * @param height height of main window
+   * @param frames_in_flight frames recorded while gpu works on previous ones, independent of swapchain image count.
+   *                         more frames keep gpu busy when cpu time of frames varies, fewer frames have lower input latency and memory
    */
-  TK_API void init(std::string_view title, uint32_t width, uint32_t height);
+  TK_API void init(std::string_view title, uint32_t width, uint32_t height, uint32_t frames_in_flight = 2);
 
   TK_API auto get_window_size() -> glm::vec2;
 
@@ -32,7 +35,11 @@ namespace tk
    */
   TK_API auto event_process() -> type::WindowState;
 
-  TK_API void render();
+  /**
+   * render a frame, or skip it and tell why
+   * @return result of frame, ui of skipped frame is discarded
+   */
+  TK_API auto render() -> type::FrameResult;
   
   TK_API void destroy();
 
@@ -41,6 +48,73 @@ namespace tk
   /**
    * load fonts, can dynamic load
    * @param fonts
+   * @param render_mode msdf keeps sharp corners of glyphs with smaller bitmaps, but uses rgba atlases
+   */
+  TK_API void load_fonts(std::vector<std::string_view> fonts, type::FontRenderMode render_mode = type::FontRenderMode::sdf);
+
+  /**
+   * load fonts on background thread, not block rendering.
+   * fonts are available together at a later frame after all of them loaded,
+   * before that, text is displayed by missing glyphs.
+   * exception of loading is thrown from tk::render
+   * @param fonts
+   * @param render_mode
+   */
+  TK_API void load_fonts_async(std::vector<std::string_view> fonts, type::FontRenderMode render_mode = type::FontRenderMode::sdf);
+
+  // whether some fonts loaded by load_fonts_async are not available yet
+  TK_API auto is_loading_fonts() -> bool;
+
+  /**
+   * queue glyphs of text to be generated in idle time of later frames,
+   * such as character set of a script, so drawing them first time will not stall.
+   * fonts of them should be loaded
+   * @param text
+   * @param style
+   * @param size glyphs are generated in resolution of this render size
+   */
+  TK_API void preload_glyphs(std::string_view text, type::FontStyle style = type::FontStyle::regular, float size = 32.f);
+
+  /**
+   * max time spent on generating glyphs in a frame, default is 4 ms.
+   * glyphs over budget are drawn by lower resolution or missing glyph until generated in later frames
+   * @param milliseconds
+   */
+  TK_API void set_glyph_generation_budget(float milliseconds);
+
+  /**
+   * prepare texts which will be drawn later, such as next lines of dialogue.
+   * they are shaped and laid out now, and their glyphs are generated on background thread,
+   * so drawing them later costs same as a normal frame
+   * @param texts
+   * @param size render size
+   * @param width 0 for ui::text, otherwise width of ui::paragraph or height of ui::vertical_paragraph
+   * @param style
+   * @param direction
+   */
+  TK_API void prepare_texts(std::vector<std::string_view> const& texts, float size, float width = 0.f,
+                            type::FontStyle style = type::FontStyle::regular,
+                            type::TextDirection direction = type::TextDirection::horizontal);
+
+  // frame value of next tk::render, increases by one every rendered frame
+  TK_API auto get_frame() -> uint64_t;
+
+  /**
+   * whether gpu finished rendering the frame, not block.
+   * such as reuse resources of the frame, or do other work instead of waiting
+   * @param frame value returned by tk::get_frame
+   */
+  TK_API auto is_frame_complete(uint64_t frame) -> bool;
+
+  // gpu memory used by tk, memory of swapchain images is estimated
+  TK_API auto get_memory_stats() -> type::MemoryStats;
+
+  /**
+   * callback is called at beginning of frame when usage of device local memory exceeds budget,
+   * then it is called again after usage drops under budget and exceeds again.
+   * such as free some resources in callback
+   * @param bytes 0 for budget of driver
+   * @param callback
    */
-  TK_API void load_fonts(std::vector<std::string_view> fonts);
+  TK_API void set_memory_budget(uint64_t bytes, std::function<void(type::MemoryStats const&)> callback);
 }
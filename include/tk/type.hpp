@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+
 namespace tk { namespace type {
 
   enum class Shape
@@ -37,6 +40,14 @@ namespace tk { namespace type {
     suspended,
   };
 
+  // result of rendering a frame, frame is skipped unless rendered
+  enum class FrameResult
+  {
+    rendered,
+    gpu_busy,     // gpu has not finished frame of same frame resource, only when frame is not waited such as moving window
+    out_of_date,  // swapchain is out of date until window resizes it
+  };
+
   enum class Key
   {
     space,
@@ -58,4 +69,59 @@ namespace tk { namespace type {
     italic_bold,
   };
 
-}}
\ No newline at end of file
+  // how glyph bitmaps of font are generated
+  enum class FontRenderMode
+  {
+    sdf,  // single channel, rounds off sharp corners
+    msdf, // multi channel, keeps sharp corners in smaller bitmaps
+  };
+
+  enum class TextAlign
+  {
+    left,   // top in vertical text
+    center,
+    right,  // bottom in vertical text
+  };
+
+  enum class TextDirection
+  {
+    horizontal,
+    vertical,   // characters from top to bottom, lines from right to left
+  };
+
+  // what gpu memory is used for
+  enum class MemoryCategory
+  {
+    atlas,          // glyph atlases and sprites
+    dynamic,        // per-frame data, such as vertices
+    staging,        // data uploading to images
+    render_target,  // swapchain images and offscreen images
+    Count,
+  };
+
+  struct MemoryCategoryStats
+  {
+    uint32_t allocation_count{};
+    uint64_t bytes{};
+  };
+
+  struct MemoryStats
+  {
+    std::array<MemoryCategoryStats, static_cast<uint32_t>(MemoryCategory::Count)> categories{};
+
+    uint32_t device_memory_count{};  // device memory allocations, several resources share one memory block
+    uint64_t allocated_bytes{};      // bytes of device memory allocations
+    uint64_t used_bytes{};           // bytes used by resources in device memory allocations
+    uint64_t usage{};                // usage of device local heaps
+    uint64_t budget{};               // budget of device local heaps, or fixed budget set by tk::set_memory_budget
+
+    uint32_t pending_destruction_count{};  // old resources waiting frames in flight or uploads finished
+    uint64_t pending_destruction_bytes{};  // memory of them, included in categories
+
+    uint32_t image_count{};          // images own memory, in pools or dedicated
+    uint32_t image_memory_count{};   // device memory allocations of images, pools share blocks between images
+    uint32_t aliased_image_count{};  // images alias memory of another image
+    uint64_t aliased_saved_bytes{};  // memory which aliased images would allocate without aliasing
+  };
+
+}}
@@ -16,6 +16,7 @@
 
 #include <vector>
 #include <string_view>
+#include <limits>
 
 
 namespace tk { namespace ui {
@@ -132,6 +133,86 @@ TK_API auto text(std::string_view text, glm::vec2 const& pos, float size, uint32
  */
 TK_API auto text(std::string_view text, glm::vec2 const& pos, float size, uint32_t inner_color, uint32_t outer_color) -> glm::vec2;
 
+/**
+ * draw paragraph, text is wrapped in box width by line break rules of latin and cjk
+ * line breaks are cached, so appending text or changing color will not re-layout previous lines
+ * @param text '\n' is new line
+ * @param pos left top of paragraph
+ * @param width width of box
+ * @param size
+ * @param color
+ * @param align left(default), center, right
+ * @param line_height multiple of font height
+ * @param visible_count only draw first characters, use for typewriter effect
+ * @param style regular(default), italic, bold, italic_bold
+ * @return extent of paragraph
+ */
+TK_API auto paragraph(std::string_view text, glm::vec2 const& pos, float width, float size, uint32_t color,
+                      type::TextAlign align = type::TextAlign::left, float line_height = 1.f,
+                      uint32_t visible_count = std::numeric_limits<uint32_t>::max(),
+                      type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+
+/**
+ * draw vertical paragraph (tategaki), characters are from top to bottom and columns from right to left
+ * punctuations and brackets use vertical alternates of font, layout is cached same as paragraph
+ * @param text '\n' is new column
+ * @param pos right top of paragraph
+ * @param height height of box
+ * @param size
+ * @param color
+ * @param align left(default) is top, center, right is bottom
+ * @param line_height multiple of font height, as width of column
+ * @param visible_count only draw first characters, use for typewriter effect
+ * @param style regular(default), italic, bold, italic_bold
+ * @return extent of paragraph
+ */
+TK_API auto vertical_paragraph(std::string_view text, glm::vec2 const& pos, float height, float size, uint32_t color,
+                               type::TextAlign align = type::TextAlign::left, float line_height = 1.f,
+                               uint32_t visible_count = std::numeric_limits<uint32_t>::max(),
+                               type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+
+/**
+ * draw paragraph with ruby (furigana), notation is same as aozora bunko
+ * base and rubies are laid out together and cached, so a page of annotated text is one cached lookup
+ * rubies are half size and centered on top of base, base is spread when ruby is wider and never broken
+ * @param text ｜base《ruby》, or kanji《ruby》 when base is kanji run before 《, '\n' is new line
+ * @param pos left top of paragraph, first line of rubies is included
+ * @param width width of box
+ * @param size size of base text
+ * @param color
+ * @param align left(default), center, right
+ * @param line_height multiple of font height, height of rubies is added to it
+ * @param visible_count only draw first characters without notations, ruby is drawn after its whole base
+ * @param style regular(default), italic, bold, italic_bold
+ * @return extent of paragraph
+ */
+TK_API auto ruby_paragraph(std::string_view text, glm::vec2 const& pos, float width, float size, uint32_t color,
+                           type::TextAlign align = type::TextAlign::left, float line_height = 1.f,
+                           uint32_t visible_count = std::numeric_limits<uint32_t>::max(),
+                           type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+
+/**
+ * measure text without drawing, shaping result is shared with ui::text
+ * no vertices are emitted and no glyphs are generated, so it is cheap for layout passes
+ * @param text
+ * @param size
+ * @param style regular(default), italic, bold, italic_bold
+ * @return width of advances and height of line
+ */
+TK_API auto measure_text(std::string_view text, float size, type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+
+/**
+ * measure paragraphs without drawing, layouts are shared with paragraph functions
+ * parameters are same as ui::paragraph, ui::vertical_paragraph and ui::ruby_paragraph
+ * @return extent of paragraph
+ */
+TK_API auto measure_paragraph(std::string_view text, float width, float size, float line_height = 1.f,
+                              type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+TK_API auto measure_vertical_paragraph(std::string_view text, float height, float size, float line_height = 1.f,
+                                       type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+TK_API auto measure_ruby_paragraph(std::string_view text, float width, float size, float line_height = 1.f,
+                                   type::FontStyle style = type::FontStyle::regular) -> glm::vec2;
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                UI
 ////////////////////////////////////////////////////////////////////////////////
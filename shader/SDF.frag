@@ -135,6 +135,15 @@ float get_distance(inout uint local_offset)
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//                                 glyph
+////////////////////////////////////////////////////////////////////////////////
+
+float median(float r, float g, float b)
+{
+  return max(min(r, g), min(max(r, g), b));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                             main function
 ////////////////////////////////////////////////////////////////////////////////
@@ -148,7 +157,19 @@ void main()
   {
     // reference: https://computergraphics.stackexchange.com/questions/306/sharp-corners-with-signed-distance-fields-fonts
     // author: Detheroc
-    float d = texture(glyph_atlases[nonuniformEXT(glyph_atlases_index)], uv).r - 0.5;
+    uint  atlas_index = glyph_atlases_index & ~(MSDF_Atlas_Flag | Color_Atlas_Flag);
+    bool  is_msdf     = (glyph_atlases_index & MSDF_Atlas_Flag) != 0;
+    vec4  texel       = texture(glyph_atlases[nonuniformEXT(atlas_index)], uv);
+
+    // colour glyph is premultiplied, only alpha of inner color is applied for fading
+    if ((glyph_atlases_index & Color_Atlas_Flag) != 0)
+    {
+      if (texel.a == 0.0) discard;
+      out_color = vec4(texel.rgb / texel.a, texel.a * GetInnerColor(local_offset).a);
+      return;
+    }
+    // msdf keeps sharp corners by median of three channels
+    float d = (is_msdf ? median(texel.r, texel.g, texel.b) : texel.r) - 0.5;
     float w = fwidth(d);
     float inner_alpha = clamp(d / w + 0.5, 0.0, 1.0);
 
@@ -161,7 +182,9 @@ void main()
     {
       // reference: https://www.redblobgames.com/x/2404-distance-field-effects/
       float outline_width = GetOutlineWidht(local_offset);
-      float outer_alpha   = clamp((d + outline_width) / w + 0.5, 0.0, 1.0);
+      // median is not reliable far from edges, alpha of msdf is true distance
+      float outer_d       = is_msdf ? texel.a - 0.5 : d;
+      float outer_alpha   = clamp((outer_d + outline_width) / w + 0.5, 0.0, 1.0);
 
       if (inner_color.a == 0)
         inner_color = vec4(0);
@@ -49,6 +49,11 @@ layout(push_constant) uniform PushConstant
 
 #define HeaderSize 7
 
+// glyph atlas index with this bit is msdf atlas
+#define MSDF_Atlas_Flag  0x80000000u
+// glyph atlas index with this bit is colour atlas
+#define Color_Atlas_Flag 0x40000000u
+
 #define GetData(idx)  pc.shape_properties.data[idx]
 #define GetDataF(idx) uintBitsToFloat(GetData(idx))
 #define GetVec2(idx)  vec2(GetDataF(idx), GetDataF(idx + 1))
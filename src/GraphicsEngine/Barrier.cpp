@@ -0,0 +1,114 @@
+#include "Barrier.hpp"
+#include "MemoryAllocator.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace tk { namespace graphics_engine {
+
+namespace {
+
+// stages and accesses of image used in layout
+auto get_layout_usage(VkImageLayout layout) -> std::pair<VkPipelineStageFlags2, VkAccessFlags2>
+{
+  switch (layout)
+  {
+  case VK_IMAGE_LAYOUT_UNDEFINED:
+    return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+  case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+    return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT };
+  case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+    return { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+  case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+    return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+  case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+    return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+  case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+    // presentation engine is synchronized by semaphore
+    return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+  default:
+    // such as general layout used by clear, usage is unknown
+    return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT };
+  }
+}
+
+constexpr VkAccessFlags2 Write_Accesses = VK_ACCESS_2_TRANSFER_WRITE_BIT         |
+                                          VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                          VK_ACCESS_2_SHADER_WRITE_BIT           |
+                                          VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+}
+
+auto get_layout_barrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout) -> VkImageMemoryBarrier2
+{
+  auto [src_stage, src_access] = get_layout_usage(old_layout);
+  auto [dst_stage, dst_access] = get_layout_usage(new_layout);
+
+  // swapchain image is undefined or presented before, transition must wait semaphore of acquiring,
+  // which waits at color attachment output stage.
+  // other undefined images keep none stage, which is also valid on transfer queue
+  if (old_layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR ||
+      (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL))
+    src_stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+  return VkImageMemoryBarrier2
+  {
+    .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+    .srcStageMask     = src_stage,
+    // only writes need to be available, reads only need execution dependency
+    .srcAccessMask    = src_access & Write_Accesses,
+    .dstStageMask     = dst_stage,
+    .dstAccessMask    = dst_access,
+    .oldLayout        = old_layout,
+    .newLayout        = new_layout,
+    .image            = image,
+    .subresourceRange =
+    {
+      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+      .levelCount = VK_REMAINING_MIP_LEVELS,
+      .layerCount = VK_REMAINING_ARRAY_LAYERS,
+    }
+  };
+}
+
+void pipeline_barrier(Command const& cmd, std::span<VkImageMemoryBarrier2 const> barriers)
+{
+  if (barriers.empty()) return;
+  VkDependencyInfo dep_info
+  {
+    .sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+    .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+    .pImageMemoryBarriers    = barriers.data(),
+  };
+  vkCmdPipelineBarrier2(cmd, &dep_info);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                              Barrier Batch
+////////////////////////////////////////////////////////////////////////////////
+
+auto BarrierBatch::add(Image& image, VkImageLayout layout) -> BarrierBatch&
+{
+  auto barrier = image.transition(layout);
+  if (!barrier) return *this;
+
+  // barriers of same image in one dependency are unordered,
+  // so merge them, no command uses middle layout
+  if (auto it = std::ranges::find(_image_barriers, image.handle(), &VkImageMemoryBarrier2::image); it != _image_barriers.end())
+  {
+    it->dstStageMask  = barrier->dstStageMask;
+    it->dstAccessMask = barrier->dstAccessMask;
+    it->newLayout     = barrier->newLayout;
+  }
+  else
+    _image_barriers.emplace_back(*barrier);
+  return *this;
+}
+
+void BarrierBatch::flush(Command const& cmd)
+{
+  pipeline_barrier(cmd, _image_barriers);
+  _image_barriers.clear();
+}
+
+}}
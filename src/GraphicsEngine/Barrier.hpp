@@ -0,0 +1,46 @@
+//
+// barrier
+//
+// stage and access masks of barriers are inferred from old and new layouts,
+// barriers are accumulated by batch and recorded as single dependency before commands need them.
+//
+
+#pragma once
+
+#include "CommandPool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <span>
+
+namespace tk { namespace graphics_engine {
+
+  class Image;
+
+  /**
+   * get barrier of layout transition with minimal stage and access masks
+   * @param image
+   * @param old_layout also decides which previous usage need to wait
+   * @param new_layout also decides which following usage need to be waited
+   */
+  auto get_layout_barrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout) -> VkImageMemoryBarrier2;
+
+  void pipeline_barrier(Command const& cmd, std::span<VkImageMemoryBarrier2 const> barriers);
+
+  class BarrierBatch
+  {
+  public:
+    // transition of image is recorded when flush, image layout is changed immediately
+    auto add(Image& image, VkImageLayout layout) -> BarrierBatch&;
+
+    // record all pending barriers as one dependency
+    void flush(Command const& cmd);
+
+    auto empty() const noexcept { return _image_barriers.empty(); }
+
+  private:
+    std::vector<VkImageMemoryBarrier2> _image_barriers;
+  };
+
+}}
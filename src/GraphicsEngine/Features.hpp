@@ -18,6 +18,7 @@ public:
     _features12.bufferDeviceAddress                       = VK_TRUE;
     _features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
     _features12.runtimeDescriptorArray                    = VK_TRUE;
+    _features12.timelineSemaphore                         = VK_TRUE;
 
     _features13.synchronization2 = VK_TRUE;
     _features13.dynamicRendering = VK_TRUE;
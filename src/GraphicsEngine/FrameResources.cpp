@@ -3,146 +3,252 @@
 #include "../util.hpp"
 
 #include <cassert>
+#include <bit>
+#include <algorithm>
+#include <utility>
 
 namespace tk { namespace graphics_engine {
 
 ////////////////////////////////////////////////////////////////////////////////
-///                         Vertex Buffer
+///                         Ring Buffer
 ////////////////////////////////////////////////////////////////////////////////
 
-void FramesDynamicBuffer::init(FrameResources* frame_resources, MemoryAllocator* alloc)
+namespace {
+
+constexpr auto Ring_Buffer_Usages = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT  |
+                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT         | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+
+inline auto align_position(uint64_t pos, uint32_t alignment) noexcept
+{
+  return (pos + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+}
+
+}
+
+void RingBuffer::init(FrameResources* frame_resources, MemoryAllocator* alloc)
 {
   _frame_resources = frame_resources;
   _alloc           = alloc;
-  _byte_size_pre_frame = util::align_size(config()->buffer_size, 8);
-  _buffer = alloc->create_buffer(_byte_size_pre_frame * frame_resources->size(), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  // capacity is multiple of max alignment, so alignment of position is also alignment of offset in buffer
+  _buffer = alloc->create_buffer(util::align_size(config()->buffer_size * frame_resources->size(), Max_Alignment), Ring_Buffer_Usages, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
 }
 
-void FramesDynamicBuffer::destroy()
+void RingBuffer::destroy()
 {
   _buffer.destroy();
 }
 
-auto FramesDynamicBuffer::get_current_frame_byte_offset() const -> uint32_t
+void RingBuffer::frame_end()
 {
-  throw_if(_state != State::uploaded, "[FramesDynamicBuffer] cannot get frame byte offset after upload");
-  return _current_frame_byte_offset;
+  _frame_ends.emplace_back(_frame_resources->get_frame_value(), _head);
 }
 
-void FramesDynamicBuffer::upload()
+void RingBuffer::release()
 {
-  // exceed capacity, need to expand
-  if (_current_frame_data.size() > _byte_size_pre_frame)
+  // frames are finished in order, data before end of completed frame is not used
+  while (!_frame_ends.empty() && _frame_resources->is_frame_complete(_frame_ends.front().first))
   {
-    _byte_size_pre_frame = util::align_size(std::max(_current_frame_data.size(), static_cast<size_t>(_byte_size_pre_frame * config()->buffer_expand_ratio)), 8);
-    auto tmp_buf = _alloc->create_buffer(_byte_size_pre_frame * _frame_resources->size(), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    // add destructor for old buffer
-    _frame_resources->push_old_resource([buf = this->_buffer] { buf.destroy(); });
-
-    // reset new allocation information
-    _buffer.set_realloc_info(tmp_buf);
-    // update byte offset of current frame with new byte size per frame
-    _current_frame_byte_offset = _frame_resources->get_current_frame_index() * _byte_size_pre_frame;
-    // re-upload
-    upload();
-    return;
+    _tail = std::max(_tail, _frame_ends.front().second);
+    _frame_ends.pop_front();
   }
-  memcpy(static_cast<std::byte*>(_buffer.data()) + _current_frame_byte_offset, _current_frame_data.data(), _current_frame_data.size());
-  _current_frame_data.clear();
-  _state = State::uploaded;
 }
-  
-// set state is promise the handle and address is valid
-// append_range maybe recreate a bigger buffer to make handle and address invalid
-auto FramesDynamicBuffer::get_handle_and_address() const -> std::pair<VkBuffer, VkDeviceAddress>
+
+auto RingBuffer::allocate(uint32_t size, uint32_t alignment) -> Allocation
 {
-  throw_if(_state != State::uploaded, "[FramesDynamicBuffer] must be uploaded, then handle and address will be valid");
-  return { _buffer.handle(), _buffer.address() + _current_frame_byte_offset };
+  assert(std::has_single_bit(alignment) && alignment <= Max_Alignment);
+
+  auto capacity = _buffer.capacity();
+  auto pos      = align_position(_head, alignment);
+  // wrap to beginning if rest of buffer is unenough
+  if (pos % capacity + size > capacity)
+    pos = (pos / capacity + 1) * capacity;
+  // overlap data of frames in flight, expand if completed frames not release enough space
+  if (pos + size - _tail > capacity)
+    release();
+  if (pos + size - _tail > capacity)
+  {
+    expand(size);
+    capacity = _buffer.capacity();
+    pos      = 0;
+  }
+  _head = pos + size;
+
+  auto offset = static_cast<uint32_t>(pos % capacity);
+  return
+  {
+    .data    = static_cast<std::byte*>(_buffer.data()) + offset,
+    .handle  = _buffer.handle(),
+    .offset  = offset,
+    .address = _buffer.address() + offset,
+  };
 }
 
-auto FramesDynamicBuffer::size() const -> uint32_t
+void RingBuffer::expand(uint64_t size)
 {
-  throw_if(_state != State::append_data, "[FramesDynamicBuffer] cannot get current frame data size after upload");
-  return _current_frame_data.size();
+  auto capacity = util::align_size(std::max(static_cast<uint32_t>(size), static_cast<uint32_t>(_buffer.capacity() * config()->buffer_expand_ratio)), Max_Alignment);
+  auto tmp_buf  = _alloc->create_buffer(capacity, Ring_Buffer_Usages, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+  // old buffer is used by frames in flight and allocations of current frame
+  _frame_resources->push_old_resource(_buffer.get_destroyer(), _buffer.allocation_size());
+  _buffer.set_realloc_info(tmp_buf);
+
+  // new buffer is empty
+  _head = _tail = {};
+  _frame_ends.clear();
 }
 
-void FramesDynamicBuffer::frame_begin()
+////////////////////////////////////////////////////////////////////////////////
+///                         Quad Writer
+////////////////////////////////////////////////////////////////////////////////
+
+void QuadWriter::chain(uint32_t count)
+{
+  finish_block();
+
+  // first block is enough for quads of last frame, next blocks are for overflow
+  auto capacity = _frame_quad_count == 0 ? std::max(_last_quad_count, count) : count;
+  capacity      = std::clamp(std::bit_ceil(capacity), Min_Block_Quad_Count, Max_Block_Quad_Count);
+
+  auto allocation = _ring->allocate(capacity * 4 * sizeof(Vertex));
+  _vertices = reinterpret_cast<Vertex*>(allocation.data);
+  _address  = allocation.address;
+  _capacity = capacity;
+}
+
+void QuadWriter::finish_block()
+{
+  if (_count)
+  {
+    _batches.emplace_back(_address, _count, _vertices);
+    _frame_quad_count += _count;
+  }
+  _vertices = {};
+  _address  = {};
+  _count    = _capacity = {};
+}
+
+auto QuadWriter::get_batches() -> std::span<Batch const>
+{
+  finish_block();
+  return _batches;
+}
+
+void QuadWriter::clear() noexcept
 {
-  _current_frame_data.clear();
-  _current_frame_byte_offset = _byte_size_pre_frame * _frame_resources->get_current_frame_index();
-  _state = State::append_data;
+  finish_block();
+  _last_quad_count  = std::exchange(_frame_quad_count, 0);
+  _batches.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ///                         Frame Resources
 ////////////////////////////////////////////////////////////////////////////////
 
-void FrameResources::init(VkDevice device, CommandPool& cmd_pool, Swapchain* swapchain)
+void FrameResources::init(VkDevice device, CommandPool& cmd_pool, Swapchain* swapchain, uint32_t frame_count)
 {
+  throw_if(frame_count == 0, "frames in flight should be at least one");
+
   _device    = device;
   _swapchain = swapchain;
 
-  // resize frames and submit semaphores
-  _frames.resize(swapchain->size());
-  _submit_sems.resize(swapchain->size());
+  // frames in flight are independent of swapchain images,
+  // acquire semaphore is per frame, submit semaphore is per image
+  _frames.resize(frame_count);
 
   // create commands
-  auto cmds = cmd_pool.create_commands(swapchain->size());
+  auto cmds = cmd_pool.create_commands(frame_count);
 
-  // create fence and semaphore create infos
-  auto fence_create_info = VkFenceCreateInfo
+  // one timeline semaphore paces all frames, value of a frame is signaled when it finished
+  auto type_info = VkSemaphoreTypeCreateInfo
   {
-    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-    .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+    .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+    .initialValue  = 0,
   };
-  auto sem_create_info = VkSemaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  auto timeline_sem_create_info = VkSemaphoreCreateInfo
+  {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    .pNext = &type_info,
+  };
+  throw_if(vkCreateSemaphore(device, &timeline_sem_create_info, nullptr, &_timeline_sem) != VK_SUCCESS,
+           "failed to create timeline semaphore");
 
-  // assign commands and create sync objects
-  for (auto i = 0; i < swapchain->size(); ++i)
+  // assign commands and create acquire semaphores
+  auto sem_create_info = VkSemaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+  for (auto i = 0; i < frame_count; ++i)
   {
     auto& frame = _frames[i];
     frame.cmd = cmds[i];
-    throw_if(vkCreateFence(device, &fence_create_info, nullptr, &frame.fence)         != VK_SUCCESS ||
-             vkCreateSemaphore(device, &sem_create_info, nullptr, &frame.acquire_sem) != VK_SUCCESS,
-             "failed to create sync objects");
-    throw_if(vkCreateSemaphore(device, &sem_create_info, nullptr, &_submit_sems[i]) != VK_SUCCESS, 
+    throw_if(vkCreateSemaphore(device, &sem_create_info, nullptr, &frame.acquire_sem) != VK_SUCCESS,
              "failed to create semaphore");
   }
+
+  resize_submit_semaphores();
 }
 
-void FrameResources::destroy()
+void FrameResources::resize_submit_semaphores()
 {
-  assert(_frames.size() == _submit_sems.size());
-  for (auto i = 0; i < _frames.size(); ++i)
-  {
-    auto& frame = _frames[i];
-    vkDestroyFence(_device, frame.fence, nullptr);
-    vkDestroySemaphore(_device, frame.acquire_sem, nullptr);
-    vkDestroySemaphore(_device, _submit_sems[i], nullptr);
-  }
-  while (!_destructors.empty())
+  auto sem_create_info = VkSemaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+
+  while (_submit_sems.size() > _swapchain->size())
   {
-    _destructors.front()(0, true);
-    _destructors.pop();
+    vkDestroySemaphore(_device, _submit_sems.back(), nullptr);
+    _submit_sems.pop_back();
   }
+  while (_submit_sems.size() < _swapchain->size())
+    throw_if(vkCreateSemaphore(_device, &sem_create_info, nullptr, &_submit_sems.emplace_back()) != VK_SUCCESS,
+             "failed to create semaphore");
+}
+
+void FrameResources::destroy()
+{
+  for (auto const& frame : _frames)
+    vkDestroySemaphore(_device, frame.acquire_sem, nullptr);
+  for (auto sem : _submit_sems)
+    vkDestroySemaphore(_device, sem, nullptr);
+  vkDestroySemaphore(_device, _timeline_sem, nullptr);
+  for (auto& list : _retire_lists)
+    for (auto& func : list.funcs)
+      func();
+  _retire_lists.clear();
+  _free_retire_funcs.clear();
+  _pending_destruction_count = {};
+  _pending_destruction_bytes = {};
 }
 
-auto FrameResources::acquire_swapchain_image(bool wait) -> bool
+auto FrameResources::get_completed_value() -> uint64_t
+{
+  throw_if(vkGetSemaphoreCounterValue(_device, _timeline_sem, &_completed_value) != VK_SUCCESS,
+           "failed to get value of timeline semaphore");
+  return _completed_value;
+}
+
+auto FrameResources::acquire_swapchain_image(bool wait) -> AcquireResult
 {
   // get current frame resource
   auto& frame = _frames[_frame_index];
 
-  // wait current frame resource fence usable
-  if(vkWaitForFences(_device, 1, &frame.fence, VK_TRUE, wait ? UINT_MAX : 0) != VK_SUCCESS)
-    return false;
-  throw_if(vkResetFences(_device, 1, &frame.fence) != VK_SUCCESS,
-           "failed to reset fence");
+  // wait last submit of current frame resource finished,
+  // nothing is reset, so failure of acquiring not leaves frame resource unusable
+  if (!is_frame_complete(frame.value))
+  {
+    if (!wait) return AcquireResult::not_ready;
+    auto wait_info = VkSemaphoreWaitInfo
+    {
+      .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .semaphoreCount = 1,
+      .pSemaphores    = &_timeline_sem,
+      .pValues        = &frame.value,
+    };
+    throw_if(vkWaitSemaphores(_device, &wait_info, UINT64_MAX) != VK_SUCCESS,
+             "failed to wait timeline semaphore");
+    _completed_value = std::max(_completed_value, frame.value);
+  }
 
   // acquire usable swapchain image
   auto res = vkAcquireNextImageKHR(_device, _swapchain->get(), UINT64_MAX, frame.acquire_sem, VK_NULL_HANDLE, &_submit_sem_index);
   if (res == VK_ERROR_OUT_OF_DATE_KHR)
-    return false;
+    return AcquireResult::out_of_date;
   else if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
     throw_if(true, "failed to acquire swapechain image");
 
@@ -158,27 +264,19 @@ auto FrameResources::acquire_swapchain_image(bool wait) -> bool
   };
   vkBeginCommandBuffer(frame.cmd, &command_begin_info);
 
-  return true;
-}
-
-void FrameResources::copy_image_to_swapchain(Image& image)
-{
-  auto& cmd             = _frames[_frame_index].cmd;
-  auto& swapchain_image = _swapchain->image(_submit_sem_index);
-
-  swapchain_image.set_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  image.set_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-  copy(cmd, image, swapchain_image);
+  return AcquireResult::success;
 }
 
-void FrameResources::present_swapchain_image(VkQueue graphics_queue, VkQueue present_queue)
+void FrameResources::present_swapchain_image(VkQueue graphics_queue, VkQueue present_queue,
+                                             VkSemaphore transfer_sem, uint64_t transfer_value)
 {
   // get current frame resource and submit semaphore
   auto& frame      = _frames[_frame_index];
   auto  submit_sem = _submit_sems[_submit_sem_index];
 
   // set image layout of swapchain image
-  _swapchain->image(_submit_sem_index).set_layout(frame.cmd, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+  _barriers.add(_swapchain->image(_submit_sem_index), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+           .flush(frame.cmd);
 
   // finish frameing command
   throw_if(vkEndCommandBuffer(frame.cmd) != VK_SUCCESS,
@@ -191,39 +289,56 @@ void FrameResources::present_swapchain_image(VkQueue graphics_queue, VkQueue pre
     .commandBuffer = frame.cmd,
   };
 
-  // wait semaphore submit info
-  VkSemaphoreSubmitInfo wait_sem_submit_info
+  // wait semaphore submit infos, uploads of transfer queue are only needed by sampling
+  VkSemaphoreSubmitInfo wait_sem_submit_infos[]
   {
-    .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-    .semaphore = frame.acquire_sem,
-    .value     = 1,
-    .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = frame.acquire_sem,
+      .value     = 1,
+      .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+    },
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = transfer_sem,
+      .value     = transfer_value,
+      .stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+    },
   };
 
-  // signal semaphore submit info
-  VkSemaphoreSubmitInfo signal_sem_submit_info
+  // signal semaphore submit infos, binary one for presentation and frame value for cpu
+  VkSemaphoreSubmitInfo signal_sem_submit_infos[]
   {
-    .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-    .semaphore = submit_sem,
-    .value     = 1,
-    .stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = submit_sem,
+      .value     = 1,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+    },
+    {
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = _timeline_sem,
+      .value     = _frame_value,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    },
   };
 
   // submit info
   VkSubmitInfo2 submit_info
   {
     .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-    .waitSemaphoreInfoCount   = 1,
-    .pWaitSemaphoreInfos      = &wait_sem_submit_info,
+    .waitSemaphoreInfoCount   = transfer_value > 0 ? 2u : 1u,
+    .pWaitSemaphoreInfos      = wait_sem_submit_infos,
     .commandBufferInfoCount   = 1,
     .pCommandBufferInfos      = &cmd_submit_info,
-    .signalSemaphoreInfoCount = 1,
-    .pSignalSemaphoreInfos    = &signal_sem_submit_info,
+    .signalSemaphoreInfoCount = 2,
+    .pSignalSemaphoreInfos    = signal_sem_submit_infos,
   };
 
   // queue submit
-  throw_if(vkQueueSubmit2(graphics_queue, 1, &submit_info, frame.fence),
+  throw_if(vkQueueSubmit2(graphics_queue, 1, &submit_info, VK_NULL_HANDLE),
            "failed to submit to queue");
+  frame.value = _frame_value++;
 
   // present info
   auto swapchain = _swapchain->get();
@@ -245,13 +360,42 @@ void FrameResources::present_swapchain_image(VkQueue graphics_queue, VkQueue pre
     throw_if(true, "failed to present swapchain image");
 
   // update next frame frame resource index
-  _frame_index = ++_frame_index % _swapchain->size();
+  _frame_index = ++_frame_index % _frames.size();
+}
+
+void FrameResources::push_old_resource(InplaceFunction<void()>&& func, VkDeviceSize bytes)
+{
+  // resources retired in same frame share one list
+  if (_retire_lists.empty() || _retire_lists.back().value != _frame_value)
+  {
+    auto& list = _retire_lists.emplace_back(RetireList{ .value = _frame_value });
+    if (!_free_retire_funcs.empty())
+    {
+      list.funcs = std::move(_free_retire_funcs.back());
+      _free_retire_funcs.pop_back();
+    }
+  }
+  auto& list = _retire_lists.back();
+  list.funcs.emplace_back(std::move(func));
+  list.bytes += bytes;
+  ++_pending_destruction_count;
+  _pending_destruction_bytes += bytes;
 }
 
 void FrameResources::destroy_old_resources()
 {
-  if (!_destructors.empty() && _destructors.front()(_frame_index, false))
-    _destructors.pop();
+  // lists are in order of frame values, every finished frame is drained
+  while (!_retire_lists.empty() && is_frame_complete(_retire_lists.front().value))
+  {
+    auto& list = _retire_lists.front();
+    for (auto& func : list.funcs)
+      func();
+    _pending_destruction_count -= static_cast<uint32_t>(list.funcs.size());
+    _pending_destruction_bytes -= list.bytes;
+    list.funcs.clear();
+    _free_retire_funcs.emplace_back(std::move(list.funcs));
+    _retire_lists.pop_front();
+  }
 }
 
 }}
\ No newline at end of file
@@ -7,10 +7,14 @@
 #include "CommandPool.hpp"
 #include "Swapchain.hpp"
 #include "MemoryAllocator.hpp"
+#include "Barrier.hpp"
+#include "types.hpp"
 #include "../ErrorHandling.hpp"
 
-#include <queue>
-#include <functional>
+#include <deque>
+#include <vector>
+#include <span>
+#include <algorithm>
 
 
 namespace tk { namespace graphics_engine {
@@ -18,71 +22,150 @@ namespace tk { namespace graphics_engine {
 struct FrameResource
 {
   Command     cmd;
-  VkFence     fence;
+  uint64_t    value{};     // frame value signaled when last submit of this frame resource finished
   VkSemaphore acquire_sem;
 };
 
+enum class AcquireResult
+{
+  success,
+  not_ready,    // frame resource is still used by gpu, only when not wait
+  out_of_date,  // swapchain need to be resized
+};
+
 class FrameResources;
 
-class FramesDynamicBuffer
+//
+// ring buffer
+//
+// one persistently mapped buffer shared by all frames, every allocation is a pointer bump.
+// data of a frame is released when its frame value is completed,
+// data can be written before frame begins, it belongs to the next submitted frame.
+// allocation which not fit in rest of buffer wraps to beginning,
+// if data of frames in flight still occupy there, a bigger buffer is created and old one is retired.
+//
+class RingBuffer
 {
-  enum class State
-  {
-    append_data,
-    uploaded,
-  }; 
-
 public:
-  FramesDynamicBuffer()                                      = default;
-  FramesDynamicBuffer(FramesDynamicBuffer const&)            = delete;
-  FramesDynamicBuffer(FramesDynamicBuffer&&)                 = delete;
-  FramesDynamicBuffer& operator=(FramesDynamicBuffer const&) = delete;
-  FramesDynamicBuffer& operator=(FramesDynamicBuffer&&)      = delete;
+  struct Allocation
+  {
+    std::byte*      data{};
+    VkBuffer        handle{};
+    uint32_t        offset{};
+    VkDeviceAddress address{};
+  };
+
+  RingBuffer()                             = default;
+  RingBuffer(RingBuffer const&)            = delete;
+  RingBuffer(RingBuffer&&)                 = delete;
+  RingBuffer& operator=(RingBuffer const&) = delete;
+  RingBuffer& operator=(RingBuffer&&)      = delete;
 
   void init(FrameResources* frame_resources, MemoryAllocator* alloc);
   void destroy();
 
-  void frame_begin();
+  // release data of completed frames, no wait
+  void release();
+  // data allocated until now belongs to current frame, call before it is submitted
+  void frame_end();
 
-  auto get_current_frame_byte_offset() const -> uint32_t;
+  /**
+   * allocate memory of current frame, it is valid until the frame is reused
+   * @param size
+   * @param alignment power of two, not bigger than Max_Alignment
+   */
+  auto allocate(uint32_t size, uint32_t alignment = Default_Alignment) -> Allocation;
 
   template <typename T>
   requires std::ranges::sized_range<T>      &&
            std::ranges::contiguous_range<T>
-  void append_range(T&& values)
+  auto append_range(T&& values, uint32_t alignment = Default_Alignment) -> Allocation
   {
-    throw_if(_state != State::append_data, "[VertexBuffer] cannot append data after upload");
-    // no value return
-    auto count = std::ranges::size(values);
-    if (count == 0) return;
-
-    // get value type
     using ValueType = std::ranges::range_value_t<T>;
+    auto byte_size  = static_cast<uint32_t>(std::ranges::size(values) * sizeof(ValueType));
+    auto allocation = allocate(byte_size, alignment);
+    if (byte_size) memcpy(allocation.data, std::ranges::data(values), byte_size);
+    return allocation;
+  }
 
-    // get values byte size and current frame data size
-    auto values_byte_size = count * sizeof(ValueType);
-    auto byte_offset      = _current_frame_data.size();
+  static constexpr uint32_t Default_Alignment = 16;
+  static constexpr uint32_t Max_Alignment     = 256;
+
+private:
+  void expand(uint64_t size);
 
-    // resize frame data
-    _current_frame_data.resize(byte_offset + values_byte_size);
+private:
+  FrameResources*       _frame_resources{};
+  MemoryAllocator*      _alloc{};
+  Buffer                _buffer;
+  uint64_t              _head{};            // next allocation position, increases monotonically, offset in buffer is head % capacity
+  uint64_t              _tail{};            // oldest position used by frames in flight
+  std::deque<std::pair<uint64_t, uint64_t>> _frame_ends;  // frame value and head when the frame was ended
+};
 
-    memcpy(_current_frame_data.data() + byte_offset, std::ranges::data(values), values_byte_size);
+//
+// quad writer
+//
+// vertices of quads are written into blocks of ring buffer directly, no intermediate container.
+// vertex indices are 16 bits, so a full block is finished as a draw batch and next block is chained.
+// indices of quads are same in every batch, they are in one static index buffer.
+// first block of a frame is sized by quad count of last frame, so usually a frame is one batch.
+//
+class QuadWriter
+{
+public:
+  struct Batch
+  {
+    VkDeviceAddress vertices{};
+    uint32_t        quad_count{};
+    Vertex const*   data{};        // mapped vertices, only for reading back in tests
+  };
+
+  void init(RingBuffer* ring) noexcept { _ring = ring; }
+
+  // vertices of next quad
+  auto add() -> Vertex*
+  {
+    if (_count == _capacity) chain(1);
+    return _vertices + _count++ * 4;
+  }
+
+  /**
+   * vertices of quads in current block, all of them must be written
+   * @param count requested count, returned quads may be less when block is full
+   * @return 4 vertices per quad
+   */
+  auto add(uint32_t count) -> std::span<Vertex>
+  {
+    if (_count == _capacity) chain(count);
+    count    = std::min(count, _capacity - _count);
+    auto out = _vertices + _count * 4;
+    _count  += count;
+    return { out, count * 4 };
   }
 
-  void upload();
-  
-  auto get_handle_and_address() const -> std::pair<VkBuffer, VkDeviceAddress>;
+  // finish current block, batches are valid until clear
+  auto get_batches() -> std::span<Batch const>;
+  // discard quads after they are rendered or frame is skipped
+  void clear() noexcept;
 
-  auto size() const -> uint32_t;
+  // 16 bits index covers 65536 vertices
+  static constexpr uint32_t Max_Block_Quad_Count = 65536 / 4;
+  static constexpr uint32_t Min_Block_Quad_Count = 256;
+
+private:
+  void chain(uint32_t count);
+  void finish_block();
 
 private:
-  FrameResources*        _frame_resources{};
-  Buffer                 _buffer;
-  uint32_t               _byte_size_pre_frame;
-  uint32_t               _current_frame_byte_offset{};
-  std::vector<std::byte> _current_frame_data;
-  State                  _state = State::append_data;
-  MemoryAllocator*       _alloc{};
+  RingBuffer*        _ring{};
+  Vertex*            _vertices{};
+  VkDeviceAddress    _address{};
+  uint32_t           _count{};
+  uint32_t           _capacity{};
+  uint32_t           _frame_quad_count{};  // quads of finished blocks in current frame
+  uint32_t           _last_quad_count{};   // quads of last frame
+  std::vector<Batch> _batches;
 };
 
 class FrameResources
@@ -94,43 +177,69 @@ public:
   FrameResources& operator=(FrameResources const&) = delete;
   FrameResources& operator=(FrameResources&&)      = delete;
 
-  void init(VkDevice device, CommandPool& cmd_pool, Swapchain* swapchain);
+  // frame count is count of frames in flight, independent of swapchain image count
+  void init(VkDevice device, CommandPool& cmd_pool, Swapchain* swapchain, uint32_t frame_count);
   void destroy();
+  // image count may be changed by resizing swapchain, device should be idle
+  void resize_submit_semaphores();
 
   auto& get_command() const noexcept { return _frames[_frame_index].cmd; }
-
-  auto acquire_swapchain_image(bool wait) -> bool;
-  void copy_image_to_swapchain(Image& image);
-  void present_swapchain_image(VkQueue graphics_queue, VkQueue present_queue);
+  // pending barriers of current frame
+  auto& get_barriers() noexcept { return _barriers; }
+
+  /**
+   * wait frame resource finished by gpu, then acquire swapchain image and begin command
+   * @param wait false for returning not_ready immediately if gpu still uses frame resource
+   */
+  auto acquire_swapchain_image(bool wait) -> AcquireResult;
+  // transfer_value is timeline value of transfer queue to wait before fragment shader, 0 is no wait
+  void present_swapchain_image(VkQueue graphics_queue, VkQueue present_queue,
+                               VkSemaphore transfer_sem = VK_NULL_HANDLE, uint64_t transfer_value = 0);
   auto& get_swapchain_image() noexcept { return _swapchain->image(_submit_sem_index); }
 
   void destroy_old_resources();
   auto get_current_frame_index() const noexcept { return _frame_index; }
   auto size() const noexcept { return _frames.size(); }
-  auto push_old_resource(std::function<void()>&& func)
-  {
-    _destructors.push(
-      [frame_index = _frame_index, func]
-      (uint32_t current_frame_index, bool directly_destruct)
-      {
-        if (directly_destruct || current_frame_index == frame_index)
-        {
-          func();
-          return true;
-        }
-        return false;
-      });
-  }
+  /**
+   * destroy after current frame finished
+   * @param func
+   * @param bytes memory released by func
+   */
+  void push_old_resource(InplaceFunction<void()>&& func, VkDeviceSize bytes = 0);
+  auto get_pending_destruction_count() const noexcept { return _pending_destruction_count; }
+  auto get_pending_destruction_bytes() const noexcept { return _pending_destruction_bytes; }
+
+  //
+  // frame values increase monotonically, current frame value is signaled on timeline semaphore when it finished
+  //
+  auto get_frame_value() const noexcept { return _frame_value; }
+  // largest frame value finished by gpu, no wait
+  auto get_completed_value() -> uint64_t;
+  auto is_frame_complete(uint64_t value) -> bool { return value <= _completed_value || value <= get_completed_value(); }
 
 private:
   VkDevice                   _device;
-  std::vector<FrameResource> _frames;
-  std::vector<VkSemaphore>   _submit_sems;
+  std::vector<FrameResource> _frames;       // count of frames in flight
+  std::vector<VkSemaphore>   _submit_sems;  // one per swapchain image, it is reused only after image is acquired again
   uint32_t                   _frame_index{};
   uint32_t                   _submit_sem_index{};
   Swapchain*                 _swapchain{};
+  BarrierBatch               _barriers;
+  VkSemaphore                _timeline_sem{};
+  uint64_t                   _frame_value{ 1 };
+  uint64_t                   _completed_value{};
 
-  std::queue<std::function<bool(uint32_t, bool)>> _destructors;
+  // old resources retired by each frame, all of them are destroyed when the frame finished
+  struct RetireList
+  {
+    uint64_t                             value{};
+    VkDeviceSize                         bytes{};
+    std::vector<InplaceFunction<void()>> funcs;
+  };
+  std::deque<RetireList>                            _retire_lists;
+  std::vector<std::vector<InplaceFunction<void()>>> _free_retire_funcs;  // drained vectors keep capacity for reusing
+  uint32_t                                          _pending_destruction_count{};
+  VkDeviceSize                                      _pending_destruction_bytes{};
 };
 
 }}
\ No newline at end of file
@@ -8,8 +8,10 @@
 #include "TextEngine/TextEngine.hpp"
 #include "FrameResources.hpp"
 #include "Pipeline/GraphicsPipeline.hpp"
+#include "TransferQueue.hpp"
 
 #include <span>
+#include <functional>
 
 namespace tk { namespace graphics_engine {
 
@@ -40,13 +42,18 @@ namespace tk { namespace graphics_engine {
      * initialize graphics engine
      * need a main window (while vulkan can use offscreen rendering)
      * @param window main window
+     * @param frames_in_flight count of frames recorded while gpu works on previous ones
      * @throw std::runtime_error failed to init
      */
-    void init(Window& window);
+    void init(Window& window, uint32_t frames_in_flight);
 
     void destroy();
 
-    void wait_fence(bool b) noexcept { _wait_fence = b; }
+    // whether frame_begin waits gpu finishing frame resource, or skips frame
+    void wait_frame(bool b) noexcept { _wait_frame = b; }
+    // value of current frame, signaled when gpu finished it
+    auto get_frame_value() const noexcept { return _frames.get_frame_value(); }
+    auto is_frame_complete(uint64_t value) { return _frames.is_frame_complete(value); }
 
     //
     // run
@@ -54,19 +61,50 @@ namespace tk { namespace graphics_engine {
     void resize_swapchain();
     auto get_swapchain_image_size() -> glm::vec2;
     
-    auto frame_begin() -> bool;
+    // frame is skipped unless success
+    auto frame_begin() -> AcquireResult;
     void frame_end();
 
     void render_end();
 
-    auto parse_text(std::string_view text, glm::vec2 pos, float size, type::FontStyle style, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices, uint32_t offset, uint16_t& idx) -> glm::vec2;
+    auto parse_text(std::string_view text, glm::vec2 pos, float size, type::FontStyle style, uint32_t offset) -> glm::vec2;
+    // width is length of lines, pos is right top for vertical text
+    auto parse_paragraph(std::string_view text, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, type::FontStyle style, type::TextDirection direction, uint32_t offset) -> glm::vec2;
+    // extents are same as parse functions, but no vertices are written and no glyphs are generated
+    auto measure_text(std::string_view text, float size, type::FontStyle style) -> glm::vec2;
+    auto measure_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style, type::TextDirection direction) -> glm::vec2;
+    auto measure_ruby_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style) -> glm::vec2;
+    // text has ruby notations, rubies are on top of lines
+    auto parse_ruby_paragraph(std::string_view text, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, type::FontStyle style, uint32_t offset) -> glm::vec2;
 
     void sdf_render_begin();
-    void sdf_render(std::span<Vertex> vertices, std::span<uint16_t> indices, std::span<ShapeProperty> shape_properties);
+    // quads written by parse functions and shapes are rendered
+    void sdf_render(std::span<ShapeProperty> shape_properties);
+    // quads of current frame, they are written into frame buffer directly
+    auto& get_quads() noexcept { return _quads; }
 
     void wait_device_complete() const noexcept { vkDeviceWaitIdle(_device); }
 
-    void load_fonts(std::vector<std::string_view> const& fonts);
+    void load_fonts(std::vector<std::string_view> const& fonts, type::FontRenderMode render_mode);
+    void load_fonts_async(std::vector<std::string_view> const& fonts, type::FontRenderMode render_mode);
+    auto is_loading_fonts() const noexcept { return _text_engine.is_loading_fonts(); }
+
+    void preload_glyphs(std::string_view text, type::FontStyle style, float size) { _text_engine.preload_glyphs(text, style, TextEngine::get_size_tier(size)); }
+    void prepare_texts(std::span<std::string_view const> texts, float size, float width, type::FontStyle style, type::TextDirection direction)
+    {
+      _text_engine.prepare_texts(texts, style, size, width / GlyphInfo::get_scale(size), direction);
+    }
+    void set_glyph_generation_budget(float milliseconds) noexcept { _text_engine.set_generation_budget(std::chrono::duration<float, std::milli>{ milliseconds }); }
+
+    auto get_memory_stats() const -> type::MemoryStats;
+    // for tests and tools creating their own resources
+    auto& get_memory_allocator() noexcept { return _mem_alloc; }
+    void set_memory_budget(uint64_t bytes, std::function<void(type::MemoryStats const&)>&& callback)
+    {
+      _memory_budget          = bytes;
+      _memory_budget_callback = std::move(callback);
+      _over_memory_budget     = false;
+    }
 
   private:
 
@@ -81,7 +119,7 @@ namespace tk { namespace graphics_engine {
     void create_swapchain();
     void init_command_pool();
     void init_memory_allocator();
-    void create_frame_resources();
+    void create_frame_resources(uint32_t frames_in_flight);
     void create_sampler();
 
     // vk extension funcs
@@ -90,6 +128,12 @@ namespace tk { namespace graphics_engine {
 
     void render_begin(Image& image);
 
+    // call budget callback when usage exceeds budget
+    void check_memory_budget();
+
+    // write quads of glyphs and rubies of laid out paragraph
+    auto add_paragraph_quads(Paragraph const& paragraph, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, uint32_t offset) -> glm::vec2;
+
     void init_text_engine();
 
     void init_gpu_resource();
@@ -107,12 +151,17 @@ namespace tk { namespace graphics_engine {
     VkDevice                     _device{};
     VkQueue                      _graphics_queue{};
     VkQueue                      _present_queue{};
+    TransferQueue                _transfer_queue;
     Swapchain                    _swapchain;
     CommandPool                  _command_pool;
     MemoryAllocator              _mem_alloc;
     DestructorStack              _destructors;
 
-    bool _wait_fence{ true };
+    bool _wait_frame{ true };
+
+    uint64_t                                       _memory_budget{};
+    std::function<void(type::MemoryStats const&)> _memory_budget_callback;
+    bool                                           _over_memory_budget{};
 
     FrameResources _frames;
 
@@ -131,8 +180,10 @@ namespace tk { namespace graphics_engine {
       glm::vec2       window_extent{};
     };
 
-    FramesDynamicBuffer _sdf_buffer;
-    GraphicsPipeline    _sdf_graphics_pipeline;
+    RingBuffer       _frame_buffer;
+    QuadWriter       _quads;
+    Buffer           _quad_indices;  // indices of max quads of a batch
+    GraphicsPipeline _sdf_graphics_pipeline;
 
     //
     // Text Rendering
@@ -1,8 +1,12 @@
 #include "MemoryAllocator.hpp"
+#include "Barrier.hpp"
 #include "../ErrorHandling.hpp"
+#include "../util.hpp"
 #include "config.hpp"
+#include "tk/log.hpp"
 
 #include <cassert>
+#include <algorithm>
 
 namespace tk { namespace graphics_engine {
 
@@ -13,15 +17,34 @@ namespace tk { namespace graphics_engine {
 void Buffer::destroy() const
 {
   assert(_allocator && _handle && _allocation);
-  vmaDestroyBuffer(_allocator->get(), _handle, _allocation);
+  get_destroyer()();
 }
 
-Buffer::Buffer(MemoryAllocator* allocator, uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags) 
+auto Buffer::get_destroyer() const -> InplaceFunction<void()>
+{
+  return [allocator = _allocator, handle = _handle, allocation = _allocation, category = _category]
+  {
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator->get(), allocation, &info);
+    allocator->remove_memory(category, info.size);
+    vmaDestroyBuffer(allocator->get(), handle, allocation);
+  };
+}
+
+auto Buffer::allocation_size() const -> VkDeviceSize
+{
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(_allocator->get(), _allocation, &info);
+  return info.size;
+}
+
+Buffer::Buffer(MemoryAllocator* allocator, uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags, type::MemoryCategory category) 
 {
   _allocator = allocator;
   _capacity  = size;
   _usages    = usages;
   _flags     = flags;
+  _category  = category;
   
   // for dynamic expand, use mapped
   flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
@@ -42,6 +65,7 @@ Buffer::Buffer(MemoryAllocator* allocator, uint32_t size, VkBufferUsageFlags usa
            "failed to create buffer");
   assert(allocation_info.pMappedData);
   _data = allocation_info.pMappedData;
+  allocator->add_memory(_category, allocation_info.size);
 
   if (usages & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
   {
@@ -62,23 +86,11 @@ void Buffer::add_tag(std::string const& tag)
 
 auto Buffer::append(void const* data, uint32_t size) -> Buffer&
 {
-  auto total_size = _size + size;
-  if (total_size <= _capacity)
-  {
-    throw_if(vmaCopyMemoryToAllocation(_allocator->get(), data, _allocation, _size, size) != VK_SUCCESS,
-             "failed to copy data to upload buffer");
-    _size = total_size;
-  }
-  // unenough, expand capacity
-  else
-  {
-    auto tmp_buf = Buffer(_allocator, std::max(total_size, static_cast<uint32_t>(_capacity * config()->buffer_expand_ratio)), _usages, _flags);
-    tmp_buf.append(_data, _size)
-           .append(data, size);
-    // destroy old buffer
-    destroy();
-    set_realloc_info(tmp_buf);
-  }
+  // growing by reallocation would copy old contents every time
+  throw_if(_size + size > _capacity, "buffer is full, use staging buffer for growing uploads");
+  throw_if(vmaCopyMemoryToAllocation(_allocator->get(), data, _allocation, _size, size) != VK_SUCCESS,
+           "failed to copy data to upload buffer");
+  _size += size;
   return *this;
 }
 
@@ -94,37 +106,234 @@ auto Buffer::set_realloc_info(Buffer& buf) -> Buffer*
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//                                  Image
+//                              Staging Buffer
 ////////////////////////////////////////////////////////////////////////////////
 
-Image::Image(MemoryAllocator* allocator, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage)
+void StagingBuffer::init(MemoryAllocator* allocator, uint32_t block_size)
 {
-  _allocator = allocator->get();
-  _device    = allocator->device();
-  _format    = format;
-  _extent    = extent;
+  _allocator   = allocator;
+  _block_size  = block_size;
+  _free_blocks = std::make_shared<std::vector<Buffer>>();
+}
+
+void StagingBuffer::destroy()
+{
+  for (auto const& block : _blocks)
+    block.destroy();
+  for (auto const& block : *_free_blocks)
+    block.destroy();
+  _blocks.clear();
+  _free_blocks.reset();
+}
 
-  VkImageCreateInfo image_info
+auto StagingBuffer::acquire_block(uint32_t size) -> Buffer
+{
+  // reuse first retired block big enough
+  if (auto it = std::ranges::find_if(*_free_blocks, [size](auto const& block) { return block.capacity() >= size; });
+      it != _free_blocks->end())
+  {
+    auto block = *it;
+    _free_blocks->erase(it);
+    block.clear();
+    return block;
+  }
+  return _allocator->create_buffer(std::max(size, _block_size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, type::MemoryCategory::staging);
+}
+
+auto StagingBuffer::append(void const* data, uint32_t size, uint32_t alignment) -> StagingRegion
+{
+  if (_blocks.empty() || util::align_size(_blocks.back().size(), alignment) + size > _blocks.back().capacity())
+    _blocks.emplace_back(acquire_block(size));
+
+  // padding for alignment is left uninitialized
+  auto& block  = _blocks.back();
+  auto  offset = util::align_size(block.size(), alignment);
+  block.add_size(offset - block.size());
+  block.append(data, size);
+  return { block.handle(), offset };
+}
+
+void StagingBuffer::append_chunks(void const* data, uint64_t size, uint32_t granularity, uint32_t alignment,
+                                  std::function<void(StagingRegion, uint64_t, uint32_t)> const& func)
+{
+  assert(size % granularity == 0);
+  throw_if(util::align_size(granularity, alignment) > _block_size, "granularity of chunks is bigger than staging block");
+
+  auto bytes = static_cast<std::byte const*>(data);
+  for (uint64_t offset{}; offset < size;)
+  {
+    // fill rest of current block by whole granules, or use a new block
+    auto rest = uint32_t{};
+    if (!_blocks.empty())
+    {
+      auto const& block = _blocks.back();
+      auto        pos   = util::align_size(block.size(), alignment);
+      if (pos < block.capacity())
+        rest = (block.capacity() - pos) / granularity * granularity;
+    }
+    if (rest == 0)
+    {
+      _blocks.emplace_back(acquire_block(_block_size));
+      continue;
+    }
+
+    auto chunk = static_cast<uint32_t>(std::min<uint64_t>(rest, size - offset));
+    func(append(bytes + offset, chunk, alignment), offset, chunk);
+    offset += chunk;
+  }
+}
+
+void StagingBuffer::retire()
+{
+  retire([this](InplaceFunction<void()>&& func, VkDeviceSize bytes) { _allocator->retire(std::move(func), bytes); });
+}
+
+void StagingBuffer::retire(std::function<void(InplaceFunction<void()>&&, VkDeviceSize)> const& hook)
+{
+  if (_blocks.empty()) return;
+
+  VkDeviceSize bytes{};
+  for (auto const& block : _blocks)
+    bytes += block.allocation_size();
+  hook([free_blocks = std::weak_ptr{ _free_blocks }, blocks = std::move(_blocks), block_size = _block_size]
+  {
+    // big blocks of single data are not kept
+    auto free = free_blocks.lock();
+    for (auto const& block : blocks)
+    {
+      if (free && block.capacity() <= block_size)
+        free->emplace_back(block);
+      else
+        block.destroy();
+    }
+  }, bytes);
+  _blocks.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//                                  Image
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+inline auto get_image_create_info(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage)
+{
+  return VkImageCreateInfo
   {
     .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
     .imageType   = VK_IMAGE_TYPE_2D,
-    .format      = _format,
-    .extent      = _extent,
+    .format      = format,
+    .extent      = extent,
     .mipLevels   = 1,
     .arrayLayers = 1,
     .samples     = VK_SAMPLE_COUNT_1_BIT,
     .tiling      = VK_IMAGE_TILING_OPTIMAL,
     .usage       = usage,
   };
+}
 
-  VmaAllocationCreateInfo alloc_info
+}
+
+Image::Image(MemoryAllocator* allocator, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, ImageClass image_class)
+{
+  _allocator = allocator;
+  _device    = allocator->device();
+  _format    = format;
+  _extent    = extent;
+  _category  = image_class == ImageClass::transient ? type::MemoryCategory::render_target : type::MemoryCategory::atlas;
+
+  auto image_info = get_image_create_info(_format, _extent, usage);
+  // uploaded images are written by transfer queue and sampled by graphics queue
+  if (image_class != ImageClass::transient && allocator->_upload_queue_families.size() > 1)
   {
-    .flags         = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-    .usage         = VMA_MEMORY_USAGE_AUTO,
+    image_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+    image_info.queueFamilyIndexCount = static_cast<uint32_t>(allocator->_upload_queue_families.size());
+    image_info.pQueueFamilyIndices   = allocator->_upload_queue_families.data();
+  }
+
+  // image bigger than block of pool uses dedicated memory, also when pool is out of memory
+  VkDeviceImageMemoryRequirements image_requirements
+  {
+    .sType       = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+    .pCreateInfo = &image_info,
   };
-  throw_if(vmaCreateImage(_allocator, &image_info, &alloc_info, &_handle, &_allocation, nullptr) != VK_SUCCESS,
+  VkMemoryRequirements2 requirements{ .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+  vkGetDeviceImageMemoryRequirements(_device, &image_requirements, &requirements);
+  auto result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+  if (requirements.memoryRequirements.size <= MemoryAllocator::Image_Pool_Block_Sizes[static_cast<uint32_t>(image_class)])
+  {
+    VmaAllocationCreateInfo alloc_info
+    {
+      .usage = VMA_MEMORY_USAGE_AUTO,
+      .pool  = allocator->get_image_pool(image_class, image_info),
+    };
+    result = vmaCreateImage(allocator->get(), &image_info, &alloc_info, &_handle, &_allocation, nullptr);
+  }
+  if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+  {
+    VmaAllocationCreateInfo alloc_info
+    {
+      .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+      .usage = VMA_MEMORY_USAGE_AUTO,
+    };
+    result = vmaCreateImage(allocator->get(), &image_info, &alloc_info, &_handle, &_allocation, nullptr);
+    throw_if(result != VK_SUCCESS, "failed to create image");
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator->get(), _allocation, &info);
+    _dedicated = true;
+    ++allocator->_dedicated_image_count;
+    allocator->_dedicated_image_bytes += info.size;
+  }
+  throw_if(result != VK_SUCCESS, "failed to create image");
+
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(allocator->get(), _allocation, &info);
+  allocator->add_memory(_category, info.size);
+
+  create_view();
+}
+
+Image::Image(MemoryAllocator* allocator, Image const& memory, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage)
+{
+  assert(memory._allocation && !memory._aliased);
+
+  _allocator = allocator;
+  _device    = allocator->device();
+  _format    = format;
+  _extent    = extent;
+  _aliased   = true;
+
+  auto image_info = get_image_create_info(_format, _extent, usage);
+  throw_if(vkCreateImage(_device, &image_info, nullptr, &_handle) != VK_SUCCESS,
            "failed to create image");
 
+  // memory must be enough and suitable for aliased image
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(_device, _handle, &requirements);
+  VmaAllocationInfo info;
+  vmaGetAllocationInfo(allocator->get(), memory._allocation, &info);
+  // aliased image is bound at offset of allocation in its memory block
+  if (requirements.size > info.size || !(requirements.memoryTypeBits & (1u << info.memoryType)) ||
+      info.offset % requirements.alignment != 0)
+  {
+    vkDestroyImage(_device, _handle, nullptr);
+    throw_if(true, "memory of image is unsuitable for aliased image");
+  }
+  if (vmaBindImageMemory(allocator->get(), memory._allocation, _handle) != VK_SUCCESS)
+  {
+    vkDestroyImage(_device, _handle, nullptr);
+    throw_if(true, "failed to bind memory to aliased image");
+  }
+  _allocation = memory._allocation;
+
+  ++allocator->_aliased_image_count;
+  allocator->_aliased_image_bytes += requirements.size;
+
+  create_view();
+}
+
+void Image::create_view()
+{
   VkImageViewCreateInfo image_view_info
   {
     .sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -138,42 +347,22 @@ Image::Image(MemoryAllocator* allocator, VkFormat format, VkExtent3D extent, VkI
       .layerCount = 1,
     },
   };
-  throw_if(vkCreateImageView(allocator->device(), &image_view_info, nullptr, &_view) != VK_SUCCESS,
+  throw_if(vkCreateImageView(_device, &image_view_info, nullptr, &_view) != VK_SUCCESS,
            "failed to create image view");
 }
 
-auto Image::set_layout(class Command const& cmd, VkImageLayout layout) -> Image&
+auto Image::transition(VkImageLayout layout) -> std::optional<VkImageMemoryBarrier2>
 {
-  if (_layout == layout) return *this;
-  VkImageMemoryBarrier2 barrier
-  {
-    .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-    // HACK: use all commands bit will stall the GPU pipeline a bit, is inefficient.
-    // should make stageMask more accurate.
-    // reference: https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples
-    .srcStageMask     = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-    .srcAccessMask    = VK_ACCESS_2_MEMORY_WRITE_BIT,
-    .dstStageMask     = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-    .dstAccessMask    = VK_ACCESS_2_MEMORY_READ_BIT  |
-                        VK_ACCESS_2_MEMORY_WRITE_BIT,
-    .oldLayout        = _layout,
-    .newLayout        = layout,
-    .image            = _handle,
-    .subresourceRange =  
-    { 
-      .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, 
-      .levelCount = VK_REMAINING_MIP_LEVELS,
-      .layerCount = VK_REMAINING_ARRAY_LAYERS,
-    }
-  };
-  VkDependencyInfo dep_info
-  {
-    .sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-    .imageMemoryBarrierCount = 1,
-    .pImageMemoryBarriers    = &barrier,
-  };
-  vkCmdPipelineBarrier2(cmd, &dep_info);
+  if (_layout == layout) return {};
+  auto barrier = get_layout_barrier(_handle, _layout, layout);
   _layout = layout;
+  return barrier;
+}
+
+auto Image::set_layout(class Command const& cmd, VkImageLayout layout) -> Image&
+{
+  if (auto barrier = transition(layout))
+    pipeline_barrier(cmd, { &*barrier, 1 });
   return *this;
 }
 
@@ -182,7 +371,27 @@ void Image::destroy()
   assert(_handle && _allocation);
 
   vkDestroyImageView(_device, _view, nullptr);
-  vmaDestroyImage(_allocator, _handle, _allocation);
+  // memory of aliased image is owned by other image
+  if (_aliased)
+  {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(_device, _handle, &requirements);
+    --_allocator->_aliased_image_count;
+    _allocator->_aliased_image_bytes -= requirements.size;
+    vkDestroyImage(_device, _handle, nullptr);
+  }
+  else
+  {
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(_allocator->get(), _allocation, &info);
+    if (_dedicated)
+    {
+      --_allocator->_dedicated_image_count;
+      _allocator->_dedicated_image_bytes -= info.size;
+    }
+    _allocator->remove_memory(_category, info.size);
+    vmaDestroyImage(_allocator->get(), _handle, _allocation);
+  }
 
   _allocator  = {};
   _device     = {};
@@ -192,6 +401,9 @@ void Image::destroy()
   _extent     = {};
   _format     = {};
   _layout     = VK_IMAGE_LAYOUT_UNDEFINED;
+  _aliased    = {};
+  _dedicated  = {};
+  _category   = {};
 }
 
 auto Image::clear(class Command const& cmd, VkClearColorValue value) -> Image&
@@ -334,12 +546,17 @@ void copy(Command const& cmd, Buffer const& src, uint32_t buffer_offset, Image&
   vkCmdCopyBufferToImage2(cmd, &info);
 }
 
-void copy(Command const& cmd, Buffer const& src, Image& dst, std::span<CopyRegion const> regions)
+void copy(Command const& cmd, Image& dst, std::span<CopyRegion const> regions)
 {
   if (regions.empty()) return;
-  dst.set_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  auto copy_regions = std::vector<VkBufferImageCopy2>(regions.size());
-  for (auto i = 0; i < regions.size(); ++i)
+  // general layout is kept for images written and sampled at same time
+  if (dst.layout() != VK_IMAGE_LAYOUT_GENERAL)
+    dst.set_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+  // regions of same buffer are adjacent, because staging buffer fills blocks one by one
+  auto count = std::ranges::find_if(regions, [buffer = regions[0].buffer](auto const& region) { return region.buffer != buffer; }) - regions.begin();
+  auto copy_regions = std::vector<VkBufferImageCopy2>(count);
+  for (auto i = 0; i < count; ++i)
   {
     auto& copy_region = copy_regions[i];
     auto& region      = regions[i];
@@ -359,13 +576,15 @@ void copy(Command const& cmd, Buffer const& src, Image& dst, std::span<CopyRegio
   VkCopyBufferToImageInfo2 info
   {
     .sType          = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
-    .srcBuffer      = src.handle(),
+    .srcBuffer      = regions[0].buffer,
     .dstImage       = dst.handle(),
-    .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    .dstImageLayout = dst.layout(),
     .regionCount    = static_cast<uint32_t>(copy_regions.size()),
     .pRegions       = copy_regions.data(),
   };
   vkCmdCopyBufferToImage2(cmd, &info);
+
+  copy(cmd, dst, regions.subspan(count));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -394,10 +613,113 @@ void MemoryAllocator::init(VkPhysicalDevice physical_device, VkDevice device, Vk
 
 void MemoryAllocator::destroy()
 {
+  // leak report, resources not destroyed are still counted by their categories
+  static constexpr std::array<char const*, static_cast<uint32_t>(type::MemoryCategory::Count)> category_names
+  {
+    "atlas", "dynamic", "staging", "render target",
+  };
+  for (auto i = 0; i < _category_stats.size(); ++i)
+    if (auto const& stats = _category_stats[i]; stats.allocation_count)
+      log::warn("[MemoryAllocator] leak {} allocations of {} with {} bytes", stats.allocation_count, category_names[i], stats.bytes);
+  _category_stats = {};
+
+  for (auto& pools : _image_pools)
+  {
+    for (auto [_, pool] : pools)
+      vmaDestroyPool(_allocator, pool);
+    pools.clear();
+  }
   if (_allocator != VK_NULL_HANDLE)
     vmaDestroyAllocator(_allocator);
   _device    = VK_NULL_HANDLE;
   _allocator = VK_NULL_HANDLE;
 }
 
+auto MemoryAllocator::get_image_pool(ImageClass image_class, VkImageCreateInfo const& image_info) -> VmaPool
+{
+  VmaAllocationCreateInfo alloc_info
+  {
+    .usage = VMA_MEMORY_USAGE_AUTO,
+  };
+  uint32_t memory_type_index;
+  throw_if(vmaFindMemoryTypeIndexForImageInfo(_allocator, &image_info, &alloc_info, &memory_type_index) != VK_SUCCESS,
+           "failed to find memory type of image");
+
+  auto& pools = _image_pools[static_cast<uint32_t>(image_class)];
+  if (auto it = pools.find(memory_type_index); it != pools.end())
+    return it->second;
+
+  VmaPoolCreateInfo pool_info
+  {
+    .memoryTypeIndex = memory_type_index,
+    .blockSize       = Image_Pool_Block_Sizes[static_cast<uint32_t>(image_class)],
+  };
+  VmaPool pool;
+  throw_if(vmaCreatePool(_allocator, &pool_info, &pool) != VK_SUCCESS,
+           "failed to create image pool");
+  return pools[memory_type_index] = pool;
+}
+
+auto MemoryAllocator::get_image_memory_stats() const -> ImageMemoryStats
+{
+  ImageMemoryStats stats
+  {
+    .image_count         = _dedicated_image_count,
+    .aliased_image_count = _aliased_image_count,
+    .memory_count        = _dedicated_image_count,
+    .memory_bytes        = _dedicated_image_bytes,
+    .used_bytes          = _dedicated_image_bytes,
+    .saved_bytes         = _aliased_image_bytes,
+  };
+  for (auto const& pools : _image_pools)
+    for (auto [_, pool] : pools)
+    {
+      VmaStatistics pool_stats;
+      vmaGetPoolStatistics(_allocator, pool, &pool_stats);
+      stats.image_count  += pool_stats.allocationCount;
+      stats.memory_count += pool_stats.blockCount;
+      stats.memory_bytes += pool_stats.blockBytes;
+      stats.used_bytes   += pool_stats.allocationBytes;
+    }
+  return stats;
+}
+
+auto MemoryAllocator::get_memory_usage_and_budget() const -> std::pair<VkDeviceSize, VkDeviceSize>
+{
+  VkPhysicalDeviceMemoryProperties const* properties;
+  vmaGetMemoryProperties(_allocator, &properties);
+  auto budgets = std::array<VmaBudget, VK_MAX_MEMORY_HEAPS>{};
+  vmaGetHeapBudgets(_allocator, budgets.data());
+
+  VkDeviceSize usage{}, budget{};
+  for (auto i = 0; i < properties->memoryHeapCount; ++i)
+    if (properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+    {
+      usage  += budgets[i].usage;
+      budget += budgets[i].budget;
+    }
+  return { usage, budget };
+}
+
+auto MemoryAllocator::get_memory_stats() const -> type::MemoryStats
+{
+  VmaTotalStatistics total;
+  vmaCalculateStatistics(_allocator, &total);
+  auto [usage, budget] = get_memory_usage_and_budget();
+  auto image_stats     = get_image_memory_stats();
+  return
+  {
+    .categories          = _category_stats,
+    .device_memory_count = total.total.statistics.blockCount,
+    .allocated_bytes     = total.total.statistics.blockBytes,
+    .used_bytes          = total.total.statistics.allocationBytes,
+    .usage               = usage,
+    .budget              = budget,
+    .image_count         = image_stats.image_count,
+    .image_memory_count  = image_stats.memory_count,
+    .aliased_image_count = image_stats.aliased_image_count,
+    .aliased_saved_bytes = image_stats.saved_bytes,
+  };
+}
+
 }}
@@ -3,10 +3,19 @@
 //
 // use vma implement buffer and image allocate
 //
+// old allocations of growing buffers may still be used by frames in flight,
+// they are retired by hook of allocator and destroyed after those frames finished.
+// buffer has fixed capacity, staging buffer grows by blocks, so appending never moves existing data.
+// data bigger than a block is appended by chunks, so no big allocation is needed.
+// images are sub-allocated from pools by their class instead of dedicated memory,
+// transient images can alias memory of another image which is never alive at same time.
+//
 
 #pragma once
 
 #include "CommandPool.hpp"
+#include "tk/type.hpp"
+#include "../InplaceFunction.hpp"
 
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
@@ -15,6 +24,11 @@
 #include <unordered_map>
 #include <string>
 #include <ranges>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <array>
+#include <optional>
 
 namespace tk { namespace graphics_engine {
 
@@ -28,9 +42,11 @@ namespace tk { namespace graphics_engine {
   { 
   public:
     Buffer() = default;
-    Buffer(MemoryAllocator* allocator, uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags = 0);
+    Buffer(MemoryAllocator* allocator, uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags = 0, type::MemoryCategory category = type::MemoryCategory::dynamic);
 
     void destroy() const;
+    // destroy later by returned function, it only captures handles so fits in retire function
+    auto get_destroyer() const -> InplaceFunction<void()>;
 
     auto handle()     const noexcept { return _handle;     }
     auto allocation() const noexcept { return _allocation; }
@@ -39,6 +55,8 @@ namespace tk { namespace graphics_engine {
     auto allocator()  const noexcept { return _allocator;  }
     auto capacity()   const noexcept { return _capacity;   }
     auto size()       const noexcept { return _size;       }
+    // size of allocation, may be bigger than capacity, it is what memory stats count
+    auto allocation_size() const -> VkDeviceSize;
 
     // usefor descriptor buffer update, directly add size and tag
     
@@ -54,6 +72,7 @@ namespace tk { namespace graphics_engine {
       return *this;
     }
 
+    // capacity is fixed, growing uploads use staging buffer
     auto append(void const* data, uint32_t size) -> Buffer&;
     auto append(std::string const& tag, void const* data, uint32_t size) -> Buffer&
     {
@@ -108,13 +127,77 @@ namespace tk { namespace graphics_engine {
     std::unordered_map<std::string, uint32_t> _offsets;
     VkBufferUsageFlags                        _usages{};
     VmaAllocationCreateFlags                  _flags{};
+    type::MemoryCategory                      _category{};
+  };
+
+  // where data is in staging buffer
+  struct StagingRegion
+  {
+    VkBuffer buffer{};
+    uint32_t offset{};
+  };
+
+  class StagingBuffer
+  {
+  public:
+    /**
+     * @param allocator
+     * @param block_size size of normal block, bigger data uses its own block
+     */
+    void init(MemoryAllocator* allocator, uint32_t block_size);
+    void destroy();
+
+    /**
+     * copy data to current block, a new block is used when current one is unenough
+     * @param data
+     * @param size
+     * @param alignment alignment of offset in block
+     * @return region of data
+     */
+    auto append(void const* data, uint32_t size, uint32_t alignment = 1) -> StagingRegion;
+
+    /**
+     * copy data by chunks, every chunk is in one block, so big data not creates its own block
+     * @param data
+     * @param size multiple of granularity
+     * @param granularity size of chunk is multiple of it, such as size of image row, not bigger than block
+     * @param alignment alignment of offset in block
+     * @param func called by region of every chunk, with offset and size of chunk in data, such as to record its copy
+     */
+    void append_chunks(void const* data, uint64_t size, uint32_t granularity, uint32_t alignment,
+                       std::function<void(StagingRegion, uint64_t, uint32_t)> const& func);
+
+    // blocks appended until now are reused after frames recorded their copies finished
+    void retire();
+    // blocks are retired by hook, such as commands of other queue recorded copies
+    void retire(std::function<void(InplaceFunction<void()>&&, VkDeviceSize)> const& hook);
+
+  private:
+    auto acquire_block(uint32_t size) -> Buffer;
+
+  private:
+    MemoryAllocator*                     _allocator{};
+    uint32_t                             _block_size{};
+    std::vector<Buffer>                  _blocks;       // last one is current block
+    std::shared_ptr<std::vector<Buffer>> _free_blocks;  // retired blocks outlive staging buffer, they are destroyed if it is gone
+  };
+
+  // every class has its own pools, images of a class have similar lifetime and size
+  enum class ImageClass
+  {
+    atlas,      // glyph atlas pages, live until exit
+    sprite,     // sprite sheets and other sampled images
+    transient,  // offscreen render targets, usually alias each other
+    Count,
   };
 
   class Image
   {
   public:
     Image() = default;
-    Image(MemoryAllocator* allocator, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage);
+    Image(MemoryAllocator* allocator, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, ImageClass image_class);
+    // alias memory of another image, memory is owned by that image and must outlive this one
+    Image(MemoryAllocator* allocator, Image const& memory, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage);
     Image(VkImage handle, VkImageView view, VkExtent2D const& extent, VkFormat format)
       : _handle(handle), _view(view), _extent({ extent.width, extent.height, 1 }), _format(format) {}
 
@@ -123,6 +206,7 @@ namespace tk { namespace graphics_engine {
     auto handle()     const noexcept { return _handle;     }
     auto view()       const noexcept { return _view;       }
     auto allocation() const noexcept { return _allocation; }
+    auto layout()     const noexcept { return _layout;     }
     auto extent3D()   const noexcept { return _extent;     }
     auto extent2D()   const noexcept { return VkExtent2D{ _extent.width, _extent.height }; }
     auto format()     const noexcept { return _format;     }
@@ -130,15 +214,34 @@ namespace tk { namespace graphics_engine {
     auto set_layout(Command const& cmd, VkImageLayout layout)    -> Image&;
     auto clear(Command const& cmd, VkClearColorValue value = {}) -> Image&;
 
+    // get barrier of changing to layout and treat image as changed, no barrier if layout is same
+    auto transition(VkImageLayout layout) -> std::optional<VkImageMemoryBarrier2>;
+
+  private:
+    void create_view();
+
   private:
-    VmaAllocator  _allocator  = {};
-    VkDevice      _device     = {};
-    VkImage       _handle     = {};
-    VkImageView   _view       = {};
-    VmaAllocation _allocation = {};
-    VkExtent3D    _extent     = {};
-    VkFormat      _format     = {};
-    VkImageLayout _layout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    MemoryAllocator* _allocator  = {};
+    VkDevice         _device     = {};
+    VkImage          _handle     = {};
+    VkImageView      _view       = {};
+    VmaAllocation    _allocation = {};
+    VkExtent3D       _extent     = {};
+    VkFormat         _format     = {};
+    VkImageLayout    _layout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool             _aliased    = {};
+    bool             _dedicated  = {};  // pool is unenough for too big image
+    type::MemoryCategory _category = {};
+  };
+
+  struct ImageMemoryStats
+  {
+    uint32_t     image_count{};          // images own memory
+    uint32_t     aliased_image_count{};
+    uint32_t     memory_count{};         // device memory allocations of images, dedicated memory uses one per image
+    VkDeviceSize memory_bytes{};
+    VkDeviceSize used_bytes{};
+    VkDeviceSize saved_bytes{};          // memory shared by aliased images, which would be allocated without aliasing
   };
 
 /**
@@ -167,16 +270,19 @@ void copy(Command const& cmd, Buffer const& src, Image& dst);
 
 struct CopyRegion
 {
+  VkBuffer   buffer{};
   uint32_t   buffer_offset{};
   VkOffset2D image_offset{};
   VkExtent2D extent{};
 
-  CopyRegion(uint32_t buffer_offset, glm::vec2 const& image_offset, glm::vec2 const& extent)
-    : buffer_offset(buffer_offset),
+  CopyRegion(StagingRegion const& src, glm::vec2 const& image_offset, glm::vec2 const& extent)
+    : buffer(src.buffer),
+      buffer_offset(src.offset),
       image_offset(static_cast<int32_t>(image_offset.x), static_cast<int32_t>(image_offset.y)),
       extent(static_cast<uint32_t>(extent.x), static_cast<uint32_t>(extent.y)) {}
 };
-void copy(Command const& cmd, Buffer const& src, Image& dst, std::span<CopyRegion const> regions);
+// regions from same buffer are copied by one command
+void copy(Command const& cmd, Image& dst, std::span<CopyRegion const> regions);
 void copy(Command const& cmd, Buffer const& src, uint32_t buffer_offset, Image& dst, VkOffset2D image_offset, VkExtent2D extent);
 inline void copy(Command const& cmd, Buffer const& src, uint32_t buffer_offset, Image& dst, glm::vec2 image_offset, glm::vec2 extent)
 {
@@ -188,6 +294,7 @@ inline void copy(Command const& cmd, Buffer const& src, uint32_t buffer_offset,
 class MemoryAllocator
 {
   friend class Buffer;
+  friend class Image;
 public:
   MemoryAllocator()  = default;
   ~MemoryAllocator() = default;
@@ -203,12 +310,71 @@ public:
   auto get()    const noexcept { return _allocator; }
   auto device() const noexcept { return _device;    }
 
-  auto create_buffer(uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags = 0) { return Buffer(this, size, usages, flags);  }
-  auto create_image(VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage) { return Image(this, format, { width, height, 1 }, usage); }
+  auto create_buffer(uint32_t size, VkBufferUsageFlags usages, VmaAllocationCreateFlags flags = 0, type::MemoryCategory category = type::MemoryCategory::dynamic) { return Buffer(this, size, usages, flags, category); }
+  auto create_image(VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage, ImageClass image_class = ImageClass::sprite) { return Image(this, format, { width, height, 1 }, usage, image_class); }
+  auto create_aliased_image(Image const& memory, VkFormat format, uint32_t width, uint32_t height, VkImageUsageFlags usage) { return Image(this, memory, format, { width, height, 1 }, usage); }
+
+  auto get_image_memory_stats() const -> ImageMemoryStats;
+  // budget is usage of device local heaps and their budget
+  auto get_memory_stats() const -> type::MemoryStats;
+  auto get_memory_usage_and_budget() const -> std::pair<VkDeviceSize, VkDeviceSize>;
+
+  // memory not allocated by allocator, such as swapchain images
+  void add_memory(type::MemoryCategory category, VkDeviceSize bytes) noexcept
+  {
+    auto& stats = _category_stats[static_cast<uint32_t>(category)];
+    ++stats.allocation_count;
+    stats.bytes += bytes;
+  }
+  void remove_memory(type::MemoryCategory category, VkDeviceSize bytes) noexcept
+  {
+    auto& stats = _category_stats[static_cast<uint32_t>(category)];
+    --stats.allocation_count;
+    stats.bytes -= bytes;
+  }
+
+  // images of atlas and sprite classes are shared by these queue families, such as graphics and transfer
+  void set_upload_queue_families(std::vector<uint32_t> const& families) { _upload_queue_families = families; }
+
+  // hook delays destruction until frames in flight finished, such as FrameResources::push_old_resource
+  void set_retire_hook(std::function<void(InplaceFunction<void()>&&, VkDeviceSize)> hook) { _retire_hook = std::move(hook); }
+  /**
+   * destroy old allocation by hook, or directly if no hook
+   * @param func
+   * @param bytes memory released by func, counted as pending destruction
+   */
+  void retire(InplaceFunction<void()>&& func, VkDeviceSize bytes = 0)
+  {
+    if (_retire_hook) _retire_hook(std::move(func), bytes);
+    else              func();
+  }
+
+private:
+  // pool of image class with memory type suitable for image
+  auto get_image_pool(ImageClass image_class, VkImageCreateInfo const& image_info) -> VmaPool;
 
 private:
   VkDevice     _device    = VK_NULL_HANDLE;
   VmaAllocator _allocator = VK_NULL_HANDLE;
+  std::function<void(InplaceFunction<void()>&&, VkDeviceSize)> _retire_hook;
+  std::vector<uint32_t>                                        _upload_queue_families;
+
+  static constexpr std::array<VkDeviceSize, static_cast<uint32_t>(ImageClass::Count)> Image_Pool_Block_Sizes
+  {
+    64 * 1024 * 1024, // atlas, 4 pages of rgba or 16 pages of r8
+    64 * 1024 * 1024, // sprite
+    32 * 1024 * 1024, // transient
+  };
+  // pools of each class by memory type index
+  std::array<std::unordered_map<uint32_t, VmaPool>, static_cast<uint32_t>(ImageClass::Count)> _image_pools;
+  // images not in pools and aliased images are not counted by pool statistics
+  uint32_t     _dedicated_image_count{};
+  VkDeviceSize _dedicated_image_bytes{};
+  uint32_t     _aliased_image_count{};
+  VkDeviceSize _aliased_image_bytes{};
+
+  // tagged by resources, leaked if not empty when destroy
+  std::array<type::MemoryCategoryStats, static_cast<uint32_t>(type::MemoryCategory::Count)> _category_stats{};
 };
 
 }}
\ No newline at end of file
@@ -65,12 +65,13 @@ void check_descriptor_infos_valid(std::span<DescriptorInfo const> infos)
 
 namespace tk { namespace graphics_engine {
 
-DescriptorInfo::DescriptorInfo(ShaderType shader_type, uint32_t binding, DescriptorType descriptor_type, std::vector<Image> const& images, VkSampler sampler)
+DescriptorInfo::DescriptorInfo(ShaderType shader_type, uint32_t binding, DescriptorType descriptor_type, std::vector<Image> const& images, VkSampler sampler, VkImageLayout image_layout)
   : shader_type(to_vk_type(shader_type)),
     binding(binding),
     descriptor_type(to_vk_type(descriptor_type)),
     images(images),
-    sampler(sampler) {}
+    sampler(sampler),
+    image_layout(image_layout == VK_IMAGE_LAYOUT_UNDEFINED ? to_image_layout(this->descriptor_type) : image_layout) {}
 
 DescriptorUpdateInfo::DescriptorUpdateInfo(ShaderType shader_type, uint32_t binding, std::vector<Image> const& images)
   : shader_type(to_vk_type(shader_type)),
@@ -106,10 +107,22 @@ void GraphicsPipeline::destroy() const noexcept
 
 void GraphicsPipeline::destroy_without_shader_modules() const noexcept
 {
-  vkDestroyDescriptorSetLayout(_create_info.device, _descriptor_set_layout, nullptr);
-  vkDestroyDescriptorPool(_create_info.device, _descriptor_pool, nullptr);
-  vkDestroyPipelineLayout(_create_info.device, _pipeline_layout, nullptr);
-  vkDestroyPipeline(_create_info.device, _pipeline, nullptr);
+  get_destroyer_without_shader_modules()();
+}
+
+auto GraphicsPipeline::get_destroyer_without_shader_modules() const noexcept -> InplaceFunction<void()>
+{
+  return [device                = _create_info.device,
+          descriptor_set_layout = _descriptor_set_layout,
+          descriptor_pool       = _descriptor_pool,
+          pipeline_layout       = _pipeline_layout,
+          pipeline              = _pipeline]
+  {
+    vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+    vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+    vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+    vkDestroyPipeline(device, pipeline, nullptr);
+  };
 }
 
 void GraphicsPipeline::set_pipeline_state(Command const& cmd, VkExtent2D extent) const noexcept
@@ -258,7 +271,7 @@ void GraphicsPipeline::update_descriptor_sets(std::span<DescriptorInfo const> in
     {
       .sampler     = tmp_info.sampler,
       .imageView   = tmp_info.images[i].view(),
-      .imageLayout = to_image_layout(tmp_info.descriptor_type),
+      .imageLayout = tmp_info.image_layout,
     };
   }
 
@@ -22,13 +22,15 @@ enum class DescriptorType
 
 struct DescriptorInfo
 {
-  DescriptorInfo(ShaderType shader_type, uint32_t binding, DescriptorType descriptor_type, std::vector<Image> const& images, VkSampler sampler);
+  // image layout is undefined for default layout of descriptor type
+  DescriptorInfo(ShaderType shader_type, uint32_t binding, DescriptorType descriptor_type, std::vector<Image> const& images, VkSampler sampler, VkImageLayout image_layout = VK_IMAGE_LAYOUT_UNDEFINED);
 
   VkShaderStageFlags shader_type{};
   uint32_t           binding{};
   VkDescriptorType   descriptor_type{};
   std::vector<Image> images{};
   VkSampler          sampler{};
+  VkImageLayout      image_layout{};
 };
 
 struct DescriptorUpdateInfo
@@ -56,6 +58,8 @@ public:
   void init(GraphicsPipelineCreateInfo const& create_info);
   void destroy() const noexcept;
   void destroy_without_shader_modules() const noexcept;
+  // destroy later by returned function, such as pipeline is used by frames in flight
+  auto get_destroyer_without_shader_modules() const noexcept -> InplaceFunction<void()>;
 
   void create_descriptor_set_layout(std::span<DescriptorInfo const> infos);
   void create_descriptor_pool(std::span<DescriptorInfo const> infos);
@@ -74,6 +78,13 @@ public:
     vkCmdPushConstants(cmd, _pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constant), &push_constant);
   }
 
+  // update push constant of bound pipeline between draws
+  template <typename PushConstant>
+  void push_constant(Command const& cmd, PushConstant push_constant) const noexcept
+  {
+    vkCmdPushConstants(cmd, _pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constant), &push_constant);
+  }
+
   void set_pipeline_state(Command const& cmd, VkExtent2D extent) const noexcept;
 
   void recreate(std::vector<DescriptorUpdateInfo> const& infos);
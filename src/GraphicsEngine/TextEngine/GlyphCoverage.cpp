@@ -0,0 +1,42 @@
+#include "GlyphCoverage.hpp"
+#include "../../ErrorHandling.hpp"
+
+#include <limits>
+
+namespace tk { namespace graphics_engine {
+
+void GlyphCoverage::build(FT_Face face)
+{
+  // all pages point to empty page at first
+  _page_indices.assign(Page_Count, 0);
+  _pages.assign(1, Page{});
+  _covered_count = {};
+
+  // walk through all codepoints of current charmap
+  FT_UInt glyph_index{};
+  auto    unicode = FT_Get_First_Char(face, &glyph_index);
+  while (glyph_index != 0)
+  {
+    if (unicode < Max_Unicode)
+    {
+      throw_if(glyph_index > std::numeric_limits<uint16_t>::max(),
+               "[GlyphCoverage] glyph index {} of {} out of range", glyph_index, unicode);
+
+      // allocate page when first codepoint of it appear
+      auto& page_index = _page_indices[unicode >> Page_Bits];
+      if (page_index == 0)
+      {
+        throw_if(_pages.size() > std::numeric_limits<uint16_t>::max(), "[GlyphCoverage] too many pages");
+        page_index = static_cast<uint16_t>(_pages.size());
+        _pages.emplace_back();
+      }
+      _pages[page_index][unicode & (Page_Size - 1)] = static_cast<uint16_t>(glyph_index);
+      ++_covered_count;
+    }
+    unicode = FT_Get_Next_Char(face, unicode, &glyph_index);
+  }
+
+  _pages.shrink_to_fit();
+}
+
+}}
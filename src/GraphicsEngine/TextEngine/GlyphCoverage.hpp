@@ -0,0 +1,49 @@
+//
+// glyph coverage
+//
+// two-level table over unicode planes built from cmap of font when loading.
+// first level is indexed by high bits of codepoint and selects a page,
+// second level stores glyph index of every codepoint in that page.
+// pages without any glyph share the empty page 0,
+// so find glyph only needs two memory reads instead of FT_Get_Char_Index.
+//
+
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+namespace tk { namespace graphics_engine {
+
+  class GlyphCoverage
+  {
+  public:
+    static constexpr uint32_t Max_Unicode = 0x110000;
+    static constexpr uint32_t Page_Bits   = 8;
+    static constexpr uint32_t Page_Size   = 1 << Page_Bits;
+    static constexpr uint32_t Page_Count  = Max_Unicode >> Page_Bits;
+
+    void build(FT_Face face);
+
+    // return 0 if not covered
+    auto find_glyph(uint32_t unicode) const noexcept -> uint32_t
+    {
+      if (unicode >= Max_Unicode) return 0;
+      return _pages[_page_indices[unicode >> Page_Bits]][unicode & (Page_Size - 1)];
+    }
+
+    auto covered_count() const noexcept { return _covered_count; }
+
+  private:
+    using Page = std::array<uint16_t, Page_Size>;
+
+    std::vector<uint16_t> _page_indices;
+    std::vector<Page>     _pages;
+    uint32_t              _covered_count{};
+  };
+
+}}
@@ -0,0 +1,67 @@
+//
+// glyph table
+//
+// flat lookup table keyed by (font id, glyph id) which are got from shaping.
+// every font has a direct index table by glyph id, allocated and grown when glyph of it first appear,
+// so find only needs two memory reads.
+// values are stored densely and referenced by index, which keeps valid when table grows.
+//
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+#include <utility>
+
+namespace tk { namespace graphics_engine {
+
+  template <typename T>
+  class GlyphTable
+  {
+  public:
+    static constexpr uint32_t Invalid_Index = std::numeric_limits<uint32_t>::max();
+
+    // return nullptr if never emplaced
+    auto find(uint32_t font_id, uint32_t glyph_id) noexcept -> T*
+    {
+      auto index = find_index(font_id, glyph_id);
+      return index == Invalid_Index ? nullptr : &_values[index];
+    }
+
+    auto find_index(uint32_t font_id, uint32_t glyph_id) const noexcept -> uint32_t
+    {
+      if (font_id >= _indices.size()) return Invalid_Index;
+      auto const& indices = _indices[font_id];
+      return glyph_id < indices.size() ? indices[glyph_id] : Invalid_Index;
+    }
+
+    // return index of value and whether it is new one
+    auto try_emplace(uint32_t font_id, uint32_t glyph_id) -> std::pair<uint32_t, bool>
+    {
+      if (font_id >= _indices.size())
+        _indices.resize(font_id + 1);
+      auto& indices = _indices[font_id];
+      if (glyph_id >= indices.size())
+        indices.resize(std::max<size_t>(std::bit_ceil(glyph_id + 1), 128), Invalid_Index);
+
+      auto& index = indices[glyph_id];
+      if (index != Invalid_Index)
+        return { index, false };
+      _values.emplace_back();
+      index = static_cast<uint32_t>(_values.size() - 1);
+      return { index, true };
+    }
+
+    auto operator[](uint32_t index) noexcept -> T& { return _values[index]; }
+    auto operator[](uint32_t index) const noexcept -> T const& { return _values[index]; }
+    auto size() const noexcept { return _values.size(); }
+
+  private:
+    std::vector<std::vector<uint32_t>> _indices;
+    std::vector<T>                     _values;
+  };
+
+}}
@@ -0,0 +1,400 @@
+#include "MSDF.hpp"
+
+#include FT_OUTLINE_H
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <limits>
+#include <cmath>
+
+namespace tk { namespace graphics_engine {
+
+namespace
+{
+
+////////////////////////////////////////////////////////////////////////////////
+///                                 Shape
+////////////////////////////////////////////////////////////////////////////////
+
+enum Color : uint8_t
+{
+  Black   = 0,
+  Red     = 1,
+  Green   = 2,
+  Blue    = 4,
+  Yellow  = Red   | Green,
+  Magenta = Red   | Blue,
+  Cyan    = Green | Blue,
+  White   = Red   | Green | Blue,
+};
+
+// joint of edges is corner when angle between them is bigger than 3 radians from straight, same as msdfgen
+constexpr float    Corner_Cross_Threshold = 0.14112f; // sin(3)
+// max distance between curve and its segments in pixel
+constexpr float    Flatten_Tolerance      = 0.05f;
+constexpr uint32_t Max_Flatten_Segments   = 64;
+
+struct Segment
+{
+  glm::vec2 a{};
+  glm::vec2 b{};
+  uint8_t   color{ White };
+  bool      edge_begin{}; // pseudo distance can be extended before it
+  bool      edge_end{};   // pseudo distance can be extended after it
+};
+
+struct Edge
+{
+  uint32_t  first{};     // segments of edge
+  uint32_t  last{};
+  glm::vec2 begin_dir{}; // normalized tangents at ends
+  glm::vec2 end_dir{};
+};
+
+struct Shape
+{
+  std::vector<Segment>  segments;
+  std::vector<Edge>     edges;
+  std::vector<uint32_t> contours; // first edge of every contour
+  glm::vec2             position{};
+
+  // flatten edge from current position by evaluating it at count points
+  template <typename F>
+  void add_edge(uint32_t count, glm::vec2 begin_dir, glm::vec2 end_dir, F&& point_at)
+  {
+    auto first = static_cast<uint32_t>(segments.size());
+    auto a     = position;
+    for (uint32_t i = 1; i <= count; ++i)
+    {
+      auto b = point_at(static_cast<float>(i) / count);
+      if (b == a) continue;
+      segments.emplace_back(Segment{ a, b });
+      a = b;
+    }
+    position = a;
+
+    // degenerated edge
+    auto last = static_cast<uint32_t>(segments.size());
+    if (first == last) return;
+
+    segments[first].edge_begin = true;
+    segments.back().edge_end   = true;
+    if (begin_dir == glm::vec2{}) begin_dir = segments[first].b - segments[first].a;
+    if (end_dir   == glm::vec2{}) end_dir   = segments.back().b - segments.back().a;
+    edges.emplace_back(Edge{ first, last, glm::normalize(begin_dir), glm::normalize(end_dir) });
+  }
+};
+
+auto cross(glm::vec2 const& a, glm::vec2 const& b) noexcept
+{
+  return a.x * b.y - a.y * b.x;
+}
+
+auto to_vec2(FT_Vector const* v) noexcept
+{
+  return glm::vec2{ v->x / 64.f, v->y / 64.f };
+}
+
+// distance between curve and chords of n pieces is about deviation / n^2
+auto get_flatten_count(float deviation) noexcept
+{
+  return std::clamp(static_cast<uint32_t>(std::ceil(std::sqrt(deviation / Flatten_Tolerance))), 1u, Max_Flatten_Segments);
+}
+
+auto move_to(FT_Vector const* to, void* user) -> int
+{
+  auto& shape = *static_cast<Shape*>(user);
+  shape.contours.emplace_back(static_cast<uint32_t>(shape.edges.size()));
+  shape.position = to_vec2(to);
+  return 0;
+}
+
+auto line_to(FT_Vector const* to, void* user) -> int
+{
+  auto& shape = *static_cast<Shape*>(user);
+  auto p0 = shape.position;
+  auto p1 = to_vec2(to);
+  shape.add_edge(1, p1 - p0, p1 - p0, [&](float) { return p1; });
+  return 0;
+}
+
+auto conic_to(FT_Vector const* control, FT_Vector const* to, void* user) -> int
+{
+  auto& shape = *static_cast<Shape*>(user);
+  auto p0 = shape.position;
+  auto p1 = to_vec2(control);
+  auto p2 = to_vec2(to);
+  shape.add_edge(get_flatten_count(glm::length(p0 - 2.f * p1 + p2) / 4),
+                 p1 != p0 ? p1 - p0 : p2 - p0,
+                 p2 != p1 ? p2 - p1 : p2 - p0,
+                 [&](float t)
+                 {
+                   auto s = 1 - t;
+                   return s * s * p0 + 2 * s * t * p1 + t * t * p2;
+                 });
+  return 0;
+}
+
+auto cubic_to(FT_Vector const* control1, FT_Vector const* control2, FT_Vector const* to, void* user) -> int
+{
+  auto& shape = *static_cast<Shape*>(user);
+  auto p0 = shape.position;
+  auto p1 = to_vec2(control1);
+  auto p2 = to_vec2(control2);
+  auto p3 = to_vec2(to);
+  shape.add_edge(get_flatten_count(std::max(glm::length(p0 - 2.f * p1 + p2), glm::length(p1 - 2.f * p2 + p3)) * 3 / 4),
+                 p1 != p0 ? p1 - p0 : p2 != p0 ? p2 - p0 : p3 - p0,
+                 p3 != p2 ? p3 - p2 : p3 != p1 ? p3 - p1 : p3 - p0,
+                 [&](float t)
+                 {
+                   auto s = 1 - t;
+                   return s * s * s * p0 + 3 * s * s * t * p1 + 3 * s * t * t * p2 + t * t * t * p3;
+                 });
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///                             Edge Coloring
+////////////////////////////////////////////////////////////////////////////////
+
+auto is_corner(glm::vec2 const& a, glm::vec2 const& b) noexcept
+{
+  return glm::dot(a, b) <= 0 || std::abs(cross(a, b)) > Corner_Cross_Threshold;
+}
+
+// next color of two channels, never same as previous one and banned one
+void switch_color(uint8_t& color, uint64_t& seed, uint8_t banned = Black)
+{
+  auto combined = static_cast<uint8_t>(color & banned);
+  if (combined == Red || combined == Green || combined == Blue)
+  {
+    color = static_cast<uint8_t>(combined ^ White);
+    return;
+  }
+  if (color == Black || color == White)
+  {
+    constexpr uint8_t start[]{ Cyan, Magenta, Yellow };
+    color = start[seed % 3];
+    seed /= 3;
+    return;
+  }
+  auto shifted = color << (1 + (seed & 1));
+  color = static_cast<uint8_t>((shifted | shifted >> 3) & White);
+  seed >>= 1;
+}
+
+// split positions of n into three parts symmetrically, return -1, 0, 1
+auto symmetrical_trichotomy(uint32_t position, uint32_t n) noexcept
+{
+  return static_cast<int>(3 + 2.875f * position / (n - 1) - 1.4375f + 0.5f) - 3;
+}
+
+void color_edges(Shape& shape)
+{
+  uint8_t               color{ White };
+  uint64_t              seed{};
+  std::vector<uint32_t> corners;
+
+  for (uint32_t c = 0; c < shape.contours.size(); ++c)
+  {
+    auto begin = shape.contours[c];
+    auto end   = c + 1 < shape.contours.size() ? shape.contours[c + 1] : static_cast<uint32_t>(shape.edges.size());
+    if (begin == end) continue;
+    auto edges = std::span{ shape.edges }.subspan(begin, end - begin);
+
+    corners.clear();
+    auto prev_dir = edges.back().end_dir;
+    for (uint32_t i = 0; i < edges.size(); ++i)
+    {
+      if (is_corner(prev_dir, edges[i].begin_dir))
+        corners.emplace_back(i);
+      prev_dir = edges[i].end_dir;
+    }
+
+    auto set_color = [&](Edge const& edge, uint8_t color)
+    {
+      for (auto i = edge.first; i < edge.last; ++i)
+        shape.segments[i].color = color;
+    };
+
+    // smooth contour only uses one color
+    if (corners.empty())
+    {
+      switch_color(color, seed);
+      for (auto const& edge : edges)
+        set_color(edge, color);
+    }
+    // teardrop, split segments to three parts around the corner
+    else if (corners.size() == 1)
+    {
+      std::array<uint8_t, 3> colors{};
+      switch_color(color, seed);
+      colors[0] = color;
+      colors[1] = White;
+      switch_color(color, seed);
+      colors[2] = color;
+
+      auto segments = std::span{ shape.segments }.subspan(edges.front().first, edges.back().last - edges.front().first);
+      auto count    = static_cast<uint32_t>(segments.size());
+      auto corner   = edges[corners[0]].first - edges.front().first;
+      if (count < 3) continue;
+      for (uint32_t i = 0; i < count; ++i)
+        segments[(corner + i) % count].color = colors[1 + symmetrical_trichotomy(i, count)];
+
+      // parts of split edge are also edges, pseudo distance can be extended at their ends
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        auto& next = segments[(i + 1) % count];
+        if (segments[i].color != next.color)
+        {
+          segments[i].edge_end = true;
+          next.edge_begin      = true;
+        }
+      }
+    }
+    // switch color at every corner, color of last edge is different to first one
+    else
+    {
+      auto     count = static_cast<uint32_t>(edges.size());
+      uint32_t spline{};
+      switch_color(color, seed);
+      auto initial_color = color;
+      for (uint32_t i = 0; i < count; ++i)
+      {
+        auto index = (corners[0] + i) % count;
+        if (spline + 1 < corners.size() && corners[spline + 1] == index)
+        {
+          ++spline;
+          switch_color(color, seed, spline == corners.size() - 1 ? initial_color : Black);
+        }
+        set_color(edges[index], color);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///                               Distance
+////////////////////////////////////////////////////////////////////////////////
+
+struct Candidate
+{
+  float    distance{ std::numeric_limits<float>::max() }; // absolute distance to segment
+  float    orthogonality{}; // |cos| of angle between segment and direction to nearest point
+  uint32_t segment{ std::numeric_limits<uint32_t>::max() };
+  float    t{};             // unclamped parameter of nearest point
+
+  auto valid() const noexcept { return segment != std::numeric_limits<uint32_t>::max(); }
+
+  // segments joined at nearest point have same distance, more orthogonal one decides sign
+  auto closer_than(Candidate const& other) const noexcept
+  {
+    constexpr float epsilon = 1e-4f;
+    if (std::abs(distance - other.distance) > epsilon)
+      return distance < other.distance;
+    return orthogonality < other.orthogonality;
+  }
+};
+
+/**
+ * get signed distance to nearest segment, positive inside
+ * @param pseudo extend segment at ends of edges to line, which keeps corners sharp
+ */
+auto get_signed_distance(Shape const& shape, Candidate const& candidate, glm::vec2 const& p, float orientation, bool pseudo) noexcept
+{
+  auto const& segment = shape.segments[candidate.segment];
+  auto ab = segment.b - segment.a;
+  auto perpendicular = orientation * cross(ab, p - segment.a) / glm::length(ab);
+  if (pseudo && ((candidate.t < 0 && segment.edge_begin) || (candidate.t > 1 && segment.edge_end)))
+    return perpendicular;
+  return perpendicular >= 0 ? candidate.distance : -candidate.distance;
+}
+
+auto median(float a, float b, float c) noexcept
+{
+  return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+}
+
+auto generate_msdf(FT_Outline const& outline, uint32_t spread) -> MSDFBitmap
+{
+  Shape shape;
+  FT_Outline_Funcs funcs
+  {
+    .move_to  = move_to,
+    .line_to  = line_to,
+    .conic_to = conic_to,
+    .cubic_to = cubic_to,
+  };
+  if (FT_Outline_Decompose(const_cast<FT_Outline*>(&outline), &funcs, &shape) || shape.segments.empty())
+    return {};
+  color_edges(shape);
+
+  // truetype outer contours are clockwise, inside is right side of segments
+  auto orientation = FT_Outline_Get_Orientation(const_cast<FT_Outline*>(&outline)) == FT_ORIENTATION_POSTSCRIPT ? 1.f : -1.f;
+
+  // bitmap covers outline with spread as padding
+  FT_BBox box;
+  FT_Outline_Get_CBox(&outline, &box);
+  MSDFBitmap bitmap;
+  bitmap.left   = static_cast<int32_t>(std::floor(box.xMin / 64.f)) - static_cast<int32_t>(spread);
+  bitmap.top    = static_cast<int32_t>(std::ceil (box.yMax / 64.f)) + static_cast<int32_t>(spread);
+  bitmap.width  = static_cast<uint32_t>(static_cast<int32_t>(std::ceil (box.xMax / 64.f)) + static_cast<int32_t>(spread) - bitmap.left);
+  bitmap.height = static_cast<uint32_t>(bitmap.top - static_cast<int32_t>(std::floor(box.yMin / 64.f)) + static_cast<int32_t>(spread));
+  bitmap.data.resize(bitmap.width * bitmap.height * 4);
+
+  auto to_byte = [spread](float distance)
+  {
+    return static_cast<uint8_t>(std::lround(std::clamp(0.5f + distance / (2.f * spread), 0.f, 1.f) * 255));
+  };
+
+  for (uint32_t y = 0; y < bitmap.height; ++y)
+  for (uint32_t x = 0; x < bitmap.width;  ++x)
+  {
+    // center of texel, outline y axis is up
+    auto p = glm::vec2{ static_cast<float>(bitmap.left) + x + 0.5f, static_cast<float>(bitmap.top) - y - 0.5f };
+
+    // nearest segments of red, green, blue and all
+    std::array<Candidate, 4> nearests{};
+    for (uint32_t i = 0; i < shape.segments.size(); ++i)
+    {
+      auto const& segment = shape.segments[i];
+      auto ab = segment.b - segment.a;
+      auto t  = glm::dot(p - segment.a, ab) / glm::dot(ab, ab);
+      auto pq = p - (segment.a + ab * std::clamp(t, 0.f, 1.f));
+
+      Candidate candidate{ .distance = glm::length(pq), .segment = i, .t = t };
+      if (candidate.distance > 0)
+        candidate.orthogonality = std::abs(glm::dot(ab, pq)) / (glm::length(ab) * candidate.distance);
+
+      for (uint32_t channel = 0; channel < 3; ++channel)
+        if (segment.color & (1 << channel) && candidate.closer_than(nearests[channel]))
+          nearests[channel] = candidate;
+      if (candidate.closer_than(nearests[3]))
+        nearests[3] = candidate;
+    }
+
+    // channel without edges of its color follows true distance, median is decided by others
+    auto distance = get_signed_distance(shape, nearests[3], p, orientation, false);
+    std::array<float, 3> channels{};
+    for (uint32_t channel = 0; channel < 3; ++channel)
+      channels[channel] = nearests[channel].valid() ? get_signed_distance(shape, nearests[channel], p, orientation, true) : distance;
+
+    // median on wrong side of edge makes artifact, use true distance instead
+    if ((median(channels[0], channels[1], channels[2]) > 0) != (distance > 0))
+      channels.fill(distance);
+
+    auto texel = &bitmap.data[(y * bitmap.width + x) * 4];
+    texel[0] = to_byte(channels[0]);
+    texel[1] = to_byte(channels[1]);
+    texel[2] = to_byte(channels[2]);
+    texel[3] = to_byte(distance);
+  }
+
+  return bitmap;
+}
+
+}}
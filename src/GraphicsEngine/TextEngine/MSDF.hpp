@@ -0,0 +1,42 @@
+//
+// msdf
+//
+// multi-channel signed distance field generated from glyph outline.
+// edges of outline are colored at corners, every channel keeps distance to edges of its color,
+// so median of three channels keeps sharp corners which single channel sdf rounds off.
+// alpha channel is true signed distance, texels whose median is on wrong side of edge are corrected by it.
+//
+// curves are flattened to line segments, pseudo distance is only extended at ends of original edges.
+//
+
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <vector>
+#include <cstdint>
+
+namespace tk { namespace graphics_engine {
+
+  // same as default spread of freetype sdf renderer, so outline width is same in sdf and msdf
+  constexpr uint32_t MSDF_Spread = 8;
+
+  struct MSDFBitmap
+  {
+    std::vector<uint8_t> data; // rgba
+    uint32_t             width{};
+    uint32_t             height{};
+    int32_t              left{};
+    int32_t              top{};
+  };
+
+  /**
+   * generate msdf of outline, distance is 0.5 on edge and bigger inside
+   * @param outline in 26.6 pixel units
+   * @param spread distance in pixel mapped to [0, 1], also padding around outline
+   * @return empty bitmap if outline has no contours
+   */
+  auto generate_msdf(FT_Outline const& outline, uint32_t spread = MSDF_Spread) -> MSDFBitmap;
+
+}}
@@ -1,314 +1,941 @@
 #include "TextEngine.hpp"
 #include "../../ErrorHandling.hpp"
+#include "../../util.hpp"
 #include "missing-glyph-sdf-bitmap.hpp"
 
-#include <hb-ft.h>
 #include <hb-ot.h>
 #include <utf8.h>
 
 #include <ranges>
+#include <chrono>
 
 
 #define check(x, msg) throw_if(x, "[TextEngine] {}", msg)
 
 namespace tk { namespace graphics_engine {
 
+namespace
+{
+
+// msdf atlases store rgb channels and true distance in alpha
+auto get_glyph_atlas_format(type::FontRenderMode render_mode) noexcept
+{
+  return render_mode == type::FontRenderMode::msdf ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8_UNORM;
+}
+
+// every thread shapes with its own buffer
+auto get_hb_buffer() -> hb_buffer_t*
+{
+  struct Buffer
+  {
+    hb_buffer_t* handle{ hb_buffer_create() };
+    ~Buffer() { hb_buffer_destroy(handle); }
+  };
+  thread_local Buffer buffer;
+  return buffer.handle;
+}
+
+// vertical alternates of punctuations and brackets, harfbuzz only enables vert by default
+constexpr hb_feature_t Vertical_Features[]
+{
+  { HB_TAG('v', 'e', 'r', 't'), 1, HB_FEATURE_GLOBAL_START, HB_FEATURE_GLOBAL_END },
+  { HB_TAG('v', 'r', 't', '2'), 1, HB_FEATURE_GLOBAL_START, HB_FEATURE_GLOBAL_END },
+};
+
+// kana and han are mixed in japanese, they are shaped in one run
+auto is_cjk_script(hb_script_t script) noexcept
+{
+  return script == HB_SCRIPT_HAN      || script == HB_SCRIPT_HIRAGANA ||
+         script == HB_SCRIPT_KATAKANA || script == HB_SCRIPT_BOPOMOFO;
+}
+
+// drawing releases prepared text to eviction, measuring keeps its state
+template <typename T>
+void mark_used(T& text, uint64_t frame_count, TextUse use) noexcept
+{
+  text.last_used = frame_count;
+  if (use != TextUse::measure)
+    text.prepared = use == TextUse::prepare;
+}
+
+/**
+ * split run by script, script of run is its first strong script
+ * common and inherited characters, such as spaces, digits and marks, belong to run before them,
+ * or run after them at beginning
+ */
+template <typename F>
+void for_each_script_run(std::u32string_view run, F&& func)
+{
+  auto unicode_funcs = hb_unicode_funcs_get_default();
+  auto script        = HB_SCRIPT_COMMON;
+  size_t begin{};
+  for (size_t i = 0; i < run.size(); ++i)
+  {
+    auto current = hb_unicode_script(unicode_funcs, run[i]);
+    if (current == HB_SCRIPT_COMMON || current == HB_SCRIPT_INHERITED || current == HB_SCRIPT_UNKNOWN ||
+        current == script || (is_cjk_script(current) && is_cjk_script(script)))
+      continue;
+    if (script != HB_SCRIPT_COMMON)
+    {
+      func(run.substr(begin, i - begin), script);
+      begin = i;
+    }
+    script = current;
+  }
+  func(run.substr(begin), script);
+}
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ///                              Text Engine
 ////////////////////////////////////////////////////////////////////////////////
 
-void TextEngine::init(MemoryAllocator& alloc)
+void TextEngine::init(MemoryAllocator& alloc, uint32_t frame_count, TransferQueue* transfer_queue)
 {
   // initialize freetype
   check(FT_Init_FreeType(&_ft), "failed to initialize");
   
-  _mem_alloc = &alloc;
+  _mem_alloc        = &alloc;
+  _transfer_queue   = transfer_queue;
+  _frames_in_flight = frame_count;
 
-  // create glyph atlas and buffer
-  _glyph_atlases.emplace_back(alloc.create_image(VK_FORMAT_R8_UNORM, Glyph_Atlas_Width, Glyph_Atlas_Height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
-  _glyph_atlas_buffer = alloc.create_buffer(Glyph_Atlas_Width * Glyph_Atlas_Height, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  // create glyph atlas of first tier and buffer, atlases of other tiers are created when used
+  _glyph_atlases.emplace_back(alloc.create_image(VK_FORMAT_R8_UNORM, Glyph_Atlas_Width, Glyph_Atlas_Height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, ImageClass::atlas));
+  _packers[0][0].glyph_atlas_index = 0;
+  _glyph_atlas_buffer.init(&alloc, Glyph_Atlas_Width * Glyph_Atlas_Height);
 
-  // create harffbuzz buffer
-  _hb_buffer = hb_buffer_create();
 }
 
 void TextEngine::destroy()
 {
-  hb_buffer_destroy(_hb_buffer);
+  // preparations use fonts
+  for (auto& preparation : _preparations)
+    preparation.wait();
+  _preparations.clear();
+
+  // wait fonts loading in background
+  for (auto& loading : _font_loadings)
+  {
+    try
+    {
+      for (auto& font : loading.get())
+        font.destory(_ft_mutex);
+    }
+    // failed loading has destroyed its fonts
+    catch (std::exception const&) {}
+  }
+  _font_loadings.clear();
+
+  for (auto& [_, plan] : _shape_plans)
+    hb_shape_plan_destroy(plan);
+  _shape_plans.clear();
   _glyph_atlas_buffer.destroy();
   for (auto& image : _glyph_atlases)
     image.destroy();
   for (auto& [_, fonts]: _fonts)
     for (auto& font : fonts)
-      font.destory();
+      font.destory(_ft_mutex);
   check(FT_Done_FreeType(_ft), "failed to destroy");
 }
 
-auto TextEngine::frame_begin(Command const& cmd) -> bool
+auto TextEngine::frame_begin(Command const& cmd, BarrierBatch& barriers) -> bool
 {
+  publish_loaded_fonts();
+  upload_prepared_glyphs();
+  // staging blocks of finished uploads are reusable
+  if (_transfer_queue) _transfer_queue->collect();
+
+  // rest budget of last frame is used by glyphs over budget and preloaded glyphs,
+  // then a new budget begins for next frame
+  generate_sdf_bitmaps(true);
+  _generation_time = {};
+  ++_frame_count;
+  if (_frame_count % Text_Cache_Evict_Interval == 0)
+    evict_old_texts();
+
   // no glyphs need to upload
   if (_copy_regions.empty()) return false;
 
-  for (auto const& [glyph_atlas_index, copy_regions] : _copy_regions)
+  if (_transfer_queue)
+    upload_by_transfer_queue();
+  else
   {
-    // copy glyphs from buffer to images
-    copy(cmd, _glyph_atlas_buffer, _glyph_atlases[glyph_atlas_index], copy_regions);
-    // set image layout
-    _glyph_atlases[glyph_atlas_index].set_layout(cmd, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // all atlases are changed to transfer layout by one barrier
+    for (auto const& [glyph_atlas_index, _] : _copy_regions)
+      barriers.add(_glyph_atlases[glyph_atlas_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    barriers.flush(cmd);
+
+    for (auto const& [glyph_atlas_index, copy_regions] : _copy_regions)
+    {
+      // copy glyphs from buffer to images
+      copy(cmd, _glyph_atlases[glyph_atlas_index], copy_regions);
+      // set image layout
+      barriers.add(_glyph_atlases[glyph_atlas_index], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    // blocks of glyph atlas buffer are reused after this frame finished copying
+    _glyph_atlas_buffer.retire();
   }
 
   // clear copied glyph regions
   _copy_regions.clear();
-  // clear glyp atlas buffer
-  _glyph_atlas_buffer.clear();
 
   auto res = _new_glyph_atlas;
   _new_glyph_atlas = {};
   return res;
 }
 
-void TextEngine::preload_glyphs(Command const& cmd)
+void TextEngine::upload_by_transfer_queue()
 {
+  auto& cmd = _transfer_queue->get_command();
+
+  // new atlases are changed to general layout once
+  auto barriers = BarrierBatch{};
+  for (auto const& [glyph_atlas_index, _] : _copy_regions)
+    barriers.add(_glyph_atlases[glyph_atlas_index], VK_IMAGE_LAYOUT_GENERAL);
+  barriers.flush(cmd);
+
+  for (auto const& [glyph_atlas_index, copy_regions] : _copy_regions)
+    copy(cmd, _glyph_atlases[glyph_atlas_index], copy_regions);
+
+  // graphics queue waits this value only if it samples these atlases,
+  // semaphore makes uploads visible, so no barrier after copies
+  auto value = _transfer_queue->submit();
+  _atlas_upload_values.resize(_glyph_atlases.size());
+  for (auto const& [glyph_atlas_index, _] : _copy_regions)
+    _atlas_upload_values[glyph_atlas_index] = value;
+
+  // blocks of glyph atlas buffer are reused after uploads finished
+  _glyph_atlas_buffer.retire([this](InplaceFunction<void()>&& func, VkDeviceSize bytes) { _transfer_queue->retire(std::move(func), bytes); });
+}
+
+void TextEngine::preload_builtin_glyphs(Command const& cmd)
+{
+  _missing_glyph_index = _glyphs.try_emplace(Builtin_Font_Id, Missing_Glyph_Id).first;
   calculate_write_position({ Missing_Glyph_Width, Missing_Glyph_Height });
-  upload_glyph(cmd, Missing_Glyph_Unicode, Missing_Glyph_SDF_Bitmap,
+  upload_glyph(cmd, _missing_glyph_index, Missing_Glyph_SDF_Bitmap,
     { Missing_Glyph_Width, Missing_Glyph_Height },
-    Missing_Glyph_Left_Offset, Missing_Glyph_Up_Offset,
-    type::FontStyle::regular);
+    Missing_Glyph_Left_Offset, Missing_Glyph_Up_Offset);
+  // first atlas is sampled from first frame
+  _glyph_atlases[0].set_layout(cmd, get_glyph_atlas_layout());
 }
 
 // TODO: it's a little waste GPU memory...
-void TextEngine::calculate_write_position(glm::vec2 const& extent)
+void TextEngine::calculate_write_position(glm::vec2 const& extent, uint32_t tier, type::FontRenderMode render_mode)
 {
   check(extent.x >= Glyph_Atlas_Width || extent.y >= Glyph_Atlas_Height,
         "too big glyph sdf bitmap, cannot be stored in glyph atlas");
+
+  auto& packer = _packers[static_cast<uint32_t>(render_mode)][tier];
+  if (packer.glyph_atlas_index == std::numeric_limits<uint32_t>::max())
+    goto new_atlas;
 again:
-  auto write_max_pos = _current_write_position + extent;
-  
-  if (write_max_pos.x < Glyph_Atlas_Width && write_max_pos.y < Glyph_Atlas_Height)
   {
-    _write_positions.emplace_back(_current_glyph_atlas_index, _current_write_position);
-    _current_write_position.x = write_max_pos.x;
-    _current_line_max_glyph_height = std::max(_current_line_max_glyph_height, extent.y);
-    return;
-  }
-  else if (write_max_pos.x >= Glyph_Atlas_Width)
-  {
-    // move to next line
-    _current_write_position.x = 0;
-    _current_write_position.y += _current_line_max_glyph_height;
-    _current_line_max_glyph_height = {};
-    goto again;
-  }
-  else if (write_max_pos.y >= Glyph_Atlas_Height)
-  {
-    _new_glyph_atlas = true;
-    ++_current_glyph_atlas_index;
-    _glyph_atlases.emplace_back(_mem_alloc->create_image(VK_FORMAT_R8_UNORM, Glyph_Atlas_Width, Glyph_Atlas_Height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
-    _current_write_position = {};
-    goto again;
+    auto write_max_pos = packer.write_position + extent;
+  
+    if (write_max_pos.x < Glyph_Atlas_Width && write_max_pos.y < Glyph_Atlas_Height)
+    {
+      _write_positions.emplace_back(packer.glyph_atlas_index, packer.write_position);
+      packer.write_position.x = write_max_pos.x;
+      packer.line_max_glyph_height = std::max(packer.line_max_glyph_height, extent.y);
+      return;
+    }
+    else if (write_max_pos.x >= Glyph_Atlas_Width)
+    {
+      // move to next line
+      packer.write_position.x = 0;
+      packer.write_position.y += packer.line_max_glyph_height;
+      packer.line_max_glyph_height = {};
+      goto again;
+    }
   }
-  assert(true);
+new_atlas:
+  _new_glyph_atlas = true;
+  packer.glyph_atlas_index = static_cast<uint32_t>(_glyph_atlases.size());
+  _glyph_atlases.emplace_back(_mem_alloc->create_image(get_glyph_atlas_format(render_mode), Glyph_Atlas_Width, Glyph_Atlas_Height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, ImageClass::atlas));
+  packer.write_position        = {};
+  packer.line_max_glyph_height = {};
+  goto again;
 }
 
-void TextEngine::upload_glyph(Command const& cmd, uint32_t unicode, uint8_t const* data, glm::vec2 extent, float left_offset, float up_offset, type::FontStyle style)
+void TextEngine::upload_glyph(Command const& cmd, uint32_t entry_index, uint8_t const* data, glm::vec2 extent, float left_offset, float up_offset)
 {
   // promise only one glyph to upload and not contain it
-  assert(_write_positions.size() == 1 && !glyph_infos_has(unicode, style));
+  assert(_write_positions.size() == 1 && _glyphs[entry_index].states[0] != GlyphEntry::State::cached);
 
   auto const& [glyph_atlas_index, pos] = _write_positions[0];
   // record glyph information
   GlyphInfo info(glyph_atlas_index, pos, extent, left_offset, up_offset);
 
-  // clear buffer
-  _glyph_atlas_buffer.clear();
   // upload data to buffer
-  _glyph_atlas_buffer.append(data, extent.x * extent.y);
+  auto region = CopyRegion(_glyph_atlas_buffer.append(data, extent.x * extent.y), pos, extent);
 
   // copy glyph data from buffer to image
-  copy(cmd, _glyph_atlas_buffer, 0, _glyph_atlases[glyph_atlas_index], pos, extent);
+  copy(cmd, _glyph_atlases[glyph_atlas_index], { &region, 1 });
 
   // clear position information
   _write_positions.clear();
 
-  // store glyph information
-  _glyph_infos[style].emplace(unicode, info);
+  // store glyph information, builtin glyph only has one bitmap for all tiers
+  auto& entry = _glyphs[entry_index];
+  entry.states.fill(GlyphEntry::State::cached);
+  entry.infos.fill(info);
 }
 
-void TextEngine::upload_glyphs(std::span<SDFBitmap> bitmaps)
+void TextEngine::upload_glyphs(std::span<SDFBitmap const> bitmaps, std::span<GlyphRequest const> requests)
 {
-  // consistence between bitmaps size and uv positions size
-  assert(!bitmaps.empty() && bitmaps.size() == _write_positions.size());
+  // consistence between bitmaps size, requests size and uv positions size
+  assert(!bitmaps.empty() && bitmaps.size() == _write_positions.size() && bitmaps.size() == requests.size());
 
-  uint32_t buffer_offset = _glyph_atlas_buffer.size();
   uint32_t index{};
   _copy_regions.reserve(_copy_regions.size() + bitmaps.size());
   for (auto const& bitmap : bitmaps)
   {
+    auto  tier  = requests[index].tier;
+    auto& entry = _glyphs[requests[index].entry_index];
     // promise this is an uncached glyph
-    assert(!glyph_infos_has(bitmap.unicode, bitmap.style));
+    assert(entry.states[tier] == GlyphEntry::State::wait_generate);
 
-    auto byte_size = bitmap.extent.x * bitmap.extent.y;
     auto const& [glyph_atlas_index, write_position] = _write_positions[index];
-    // get glyph information
-    GlyphInfo info(glyph_atlas_index, write_position, bitmap.extent, bitmap.left_offset, bitmap.up_offset);
-    // record glyph information
-    _glyph_infos[bitmap.style].emplace(bitmap.unicode, info);
+    // record glyph information, extent and offsets are scaled to layout pixel size
+    // shader distinguishes msdf and colour atlases by flags of index
+    auto flag = bitmap.color ? Color_Atlas_Flag : bitmap.render_mode == type::FontRenderMode::msdf ? MSDF_Atlas_Flag : 0;
+    entry.states[tier] = GlyphEntry::State::cached;
+    entry.infos[tier]  = GlyphInfo(glyph_atlas_index | flag,
+                                   write_position, bitmap.extent, bitmap.left_offset, bitmap.up_offset,
+                                   static_cast<float>(Font::Pixel_Size) / Tier_Pixel_Sizes[tier]);
 
     if (bitmap.valid())
     {
-      // copy glyph data to buffer
-      _glyph_atlas_buffer.append(bitmap.data.data(), byte_size);
+      // copy glyph data to buffer, buffer offset of copy must be multiple of texel size
+      auto region = _glyph_atlas_buffer.append(bitmap.data.data(), bitmap.data.size(), bitmap.channel_count());
       // record copy region
-      _copy_regions[glyph_atlas_index].emplace_back( buffer_offset, write_position, bitmap.extent);
+      _copy_regions[glyph_atlas_index].emplace_back(region, write_position, bitmap.extent);
     }
 
     // move to next one
     ++index;
-    buffer_offset += byte_size;
   }
 
   // clear stored uvs
   _write_positions.clear();
 }
 
-void TextEngine::generate_sdf_bitmaps()
+void TextEngine::generate_sdf_bitmaps(bool preload)
 {
-  // promise need to generate
-  assert(!_wait_generate_sdf_bitmap_glyphs.empty());
+  if (_wait_generate_glyphs.empty() && (!preload || _preload_glyphs.empty()))
+    return;
 
-  std::vector<SDFBitmap> bitmaps;
-  bitmaps.reserve(wait_generate_glyphs_size());
-  _write_positions.reserve(bitmaps.size());
+  auto begin = std::chrono::steady_clock::now();
+  auto in_budget = [&] { return _generation_time + (std::chrono::steady_clock::now() - begin) < _generation_budget; };
 
-  for (auto& [style, unicode_pairs] : _wait_generate_sdf_bitmap_glyphs)
+  std::vector<SDFBitmap>    bitmaps;
+  std::vector<GlyphRequest> requests;
+  std::vector<GlyphRequest> deferred_requests;
+  auto generate = [&](GlyphRequest const& request)
   {
-    for (auto& [unicode, pair] : unicode_pairs)
+    auto const& entry = _glyphs[request.entry_index];
+    if (entry.color)
+    {
+      // all cells are used by recent frames, wait for one to be released
+      if (!allocate_color_cell(request.entry_index))
+      {
+        deferred_requests.emplace_back(request);
+        return;
+      }
+      bitmaps.emplace_back(entry.font->generate_color_bitmap(entry.glyph_index));
+    }
+    else
     {
-      auto& [font, glyph_index] = pair;
       // generate sdf bitmaps
-      bitmaps.emplace_back(font.generate_sdf_bitmap(glyph_index, unicode, style));
-      // calculate every bitmaps position in atlas
-      calculate_write_position(bitmaps.back().extent);
+      bitmaps.emplace_back(entry.font->generate_sdf_bitmap(entry.glyph_index, request.tier));
+      // calculate every bitmaps position in atlas of its tier and render mode
+      calculate_write_position(bitmaps.back().extent, request.tier, bitmaps.back().render_mode);
     }
+    requests.emplace_back(request);
+  };
+
+  // glyphs to draw first, left ones wait for next frame
+  auto it = _wait_generate_glyphs.begin();
+  for (; it != _wait_generate_glyphs.end() && in_budget(); ++it)
+    generate(*it);
+  _wait_generate_glyphs.erase(_wait_generate_glyphs.begin(), it);
+  _wait_generate_glyphs.insert(_wait_generate_glyphs.end(), deferred_requests.begin(), deferred_requests.end());
+  deferred_requests.clear();
+
+  // preloaded glyphs which are not drawn or generated yet
+  while (preload && !_preload_glyphs.empty() && _wait_generate_glyphs.empty() && in_budget())
+  {
+    auto request = _preload_glyphs.front();
+    _preload_glyphs.pop_front();
+    auto& state = _glyphs[request.entry_index].states[request.tier];
+    if (state != GlyphEntry::State::preload) continue;
+    state = GlyphEntry::State::wait_generate;
+    generate(request);
   }
+  _wait_generate_glyphs.insert(_wait_generate_glyphs.end(), deferred_requests.begin(), deferred_requests.end());
+
+  _generation_time += std::chrono::steady_clock::now() - begin;
 
   // upload to atlas
-  upload_glyphs(bitmaps);
+  if (!bitmaps.empty())
+    upload_glyphs(bitmaps, requests);
+}
+
+void TextEngine::prepare_texts(std::span<std::string_view const> texts, type::FontStyle style, float size, float max_width, type::TextDirection direction)
+{
+  // glyph table may grow on this thread, so job keeps what preparation thread needs
+  struct Job
+  {
+    GlyphRequest request;
+    Font*        font{};
+    uint32_t     glyph_index{};
+    bool         color{};
+  };
+  std::vector<Job> jobs;
+
+  auto size_tier = get_size_tier(size);
+  auto add_jobs  = [&](std::span<ShapedGlyph const> glyphs)
+  {
+    for (auto const& glyph : glyphs)
+    {
+      auto& entry = _glyphs[glyph.entry_index];
+      auto  tier  = entry.get_tier(size_tier);
+      if (entry.states[tier] != GlyphEntry::State::unknown &&
+          entry.states[tier] != GlyphEntry::State::preload) continue;
+
+      entry.states[tier] = GlyphEntry::State::prepare;
+      jobs.emplace_back(Job{ { glyph.entry_index, tier }, entry.font, entry.glyph_index, entry.color });
+    }
+  };
+
+  // shape and lay out on this thread, results are cached same as drawing,
+  // preparing should not break relayout of last paragraph, such as typewriter
+  for (auto text : texts)
+  {
+    if (text.empty()) continue;
+    if (max_width > 0.f)
+      add_jobs(layout_paragraph(text, style, max_width, direction, TextUse::prepare).glyphs);
+    else
+      add_jobs(shape(text, style, TextUse::prepare).glyphs);
+  }
+  if (jobs.empty()) return;
+
+  // fonts live until text engine is destroyed, which waits preparations
+  _preparations.emplace_back(std::async(std::launch::async, [this, jobs = std::move(jobs)]
+  {
+    std::lock_guard lock(_prepare_mutex);
+    std::vector<PreparedGlyph> prepared;
+    prepared.reserve(jobs.size());
+    // failure of a glyph not stops others, every glyph needs to leave prepare state on main thread
+    for (auto const& job : jobs)
+    {
+      auto& glyph = prepared.emplace_back(PreparedGlyph{ job.request });
+      try
+      {
+        job.font->open_prepare_face(_ft, _ft_mutex);
+        glyph.bitmap = job.color ? job.font->generate_color_bitmap(job.glyph_index, true)
+                                 : job.font->generate_sdf_bitmap(job.glyph_index, job.request.tier, true);
+      }
+      catch (...)
+      {
+        glyph.error = std::current_exception();
+      }
+    }
+    return prepared;
+  }));
+}
+
+void TextEngine::upload_prepared_glyphs()
+{
+  std::vector<SDFBitmap>    bitmaps;
+  std::vector<GlyphRequest> requests;
+  std::exception_ptr        error;
+  while (!_preparations.empty() && _preparations.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+  {
+    auto preparation = std::move(_preparations.front());
+    _preparations.erase(_preparations.begin());
+
+    for (auto& [request, bitmap, glyph_error] : preparation.get())
+    {
+      auto& entry = _glyphs[request.entry_index];
+      if (glyph_error)
+      {
+        entry.states[request.tier] = GlyphEntry::State::unknown;
+        if (!error) error = glyph_error;
+        continue;
+      }
+      if (entry.color)
+      {
+        // no free cell, glyph is generated again when it is drawn
+        if (!allocate_color_cell(request.entry_index))
+        {
+          entry.states[request.tier] = GlyphEntry::State::unknown;
+          continue;
+        }
+      }
+      else
+        calculate_write_position(bitmap.extent, request.tier, bitmap.render_mode);
+
+      entry.states[request.tier] = GlyphEntry::State::wait_generate;
+      bitmaps.emplace_back(std::move(bitmap));
+      requests.emplace_back(request);
+    }
+  }
+
+  if (!bitmaps.empty())
+    upload_glyphs(bitmaps, requests);
 
-  _wait_generate_sdf_bitmap_glyphs.clear();
+  // first failure of preparation thread is rethrown after other glyphs are uploaded
+  if (error) std::rethrow_exception(error);
 }
 
-void TextEngine::load_font(std::string_view path)
+auto TextEngine::allocate_color_cell(uint32_t entry_index) -> bool
+{
+  // colour atlas is created when first colour glyph is generated
+  if (_color_cells.empty())
+  {
+    _new_glyph_atlas   = true;
+    _color_atlas_index = static_cast<uint32_t>(_glyph_atlases.size());
+    _glyph_atlases.emplace_back(_mem_alloc->create_image(VK_FORMAT_R8G8B8A8_UNORM, Glyph_Atlas_Width, Glyph_Atlas_Height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, ImageClass::atlas));
+    _color_cells.resize(Color_Cell_Count);
+  }
+
+  // empty cells are never used, so they are found first
+  auto cell = std::ranges::min_element(_color_cells, {}, &ColorCell::last_used);
+  if (cell->entry_index != GlyphTable<GlyphEntry>::Invalid_Index)
+  {
+    // frames in flight may still sample it
+    if (cell->last_used + _frames_in_flight > _frame_count)
+      return false;
+    // evicted glyph is generated again when it is drawn
+    _glyphs[cell->entry_index].states[Color_Glyph_Tier] = GlyphEntry::State::unknown;
+  }
+
+  auto index = static_cast<uint32_t>(cell - _color_cells.begin());
+  *cell = { entry_index, _frame_count };
+  _glyphs[entry_index].color_cell = index;
+
+  constexpr auto columns = Glyph_Atlas_Width / Color_Cell_Size;
+  _write_positions.emplace_back(_color_atlas_index, glm::vec2{ index % columns * Color_Cell_Size, index / columns * Color_Cell_Size });
+  return true;
+}
+
+void TextEngine::preload_glyphs(std::string_view text, type::FontStyle style, uint32_t size_tier)
+{
+  if (text.empty()) return;
+
+  std::vector<ShapedGlyph> glyphs;
+  shape_text(utf8::utf8to32(text), style, glyphs);
+  for (auto const& glyph : glyphs)
+  {
+    auto& entry = _glyphs[glyph.entry_index];
+    auto  tier  = entry.get_tier(size_tier);
+    // preloaded glyph is drawn now, it is generated before other preloaded ones
+    if (entry.states[tier] != GlyphEntry::State::unknown &&
+        entry.states[tier] != GlyphEntry::State::preload) continue;
+
+    entry.states[tier] = GlyphEntry::State::preload;
+    _preload_glyphs.emplace_back(GlyphRequest{ glyph.entry_index, tier });
+  }
+}
+
+auto TextEngine::is_font_loaded(std::string_view path) const noexcept -> bool
 {
   for (auto const& [_, fonts] : _fonts)
     for (auto const& font : fonts)
-      throw_if(font._name == path, "[TextEngine] {} is already exist", path);
-  
-  auto font = Font::create(_ft, path);
-  _fonts[font._style].emplace_back(font);
+      if (font._name == path) return true;
+  return false;
+}
 
-  // clear missing glyphs and cached text advances
-  _missing_glyphs.clear();
-  for (auto const& [style, text] : _cached_texts_with_missing_glyphs)
-    _cached_text_advances[style].erase(text);
-  _cached_texts_with_missing_glyphs.clear();
+void TextEngine::load_font(std::string_view path, type::FontRenderMode render_mode)
+{
+  throw_if(is_font_loaded(path), "[TextEngine] {} is already exist", path);
+  add_font(Font::create(_ft, _ft_mutex, path, render_mode));
+}
+
+void TextEngine::load_fonts_async(std::vector<std::string> paths, type::FontRenderMode render_mode)
+{
+  _font_loadings.emplace_back(std::async(std::launch::async, [this, paths = std::move(paths), render_mode]
+  {
+    std::vector<Font> fonts;
+    fonts.reserve(paths.size());
+    try
+    {
+      for (auto const& path : paths)
+        fonts.emplace_back(Font::create(_ft, _ft_mutex, path, render_mode));
+    }
+    catch (std::exception const&)
+    {
+      for (auto& font : fonts)
+        font.destory(_ft_mutex);
+      throw;
+    }
+    return fonts;
+  }));
 }
 
-auto TextEngine::find_glyph(uint32_t unicode, type::FontStyle style) -> std::optional<std::pair<std::reference_wrapper<Font>, uint32_t>>
+void TextEngine::publish_loaded_fonts()
 {
-  // promise not generated
-  assert(!glyph_infos_has(unicode, style));
-  for (auto& font : _fonts[style])
+  // publish in order of loading, so fallback order is same as sync loading
+  while (!_font_loadings.empty() && _font_loadings.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)
   {
-    auto glyph_index = font.find_glyph(unicode);
-    if (glyph_index)
+    auto loading = std::move(_font_loadings.front());
+    _font_loadings.erase(_font_loadings.begin());
+
+    // exception of worker is rethrown here
+    auto fonts = loading.get();
+    for (uint32_t i = 0; i < fonts.size(); ++i)
     {
-      return std::make_pair(std::ref(font), glyph_index);
+      if (is_font_loaded(fonts[i]._name))
+      {
+        // fonts of batch not published yet are destroyed
+        auto name = std::move(fonts[i]._name);
+        for (auto& font : fonts | std::views::drop(i))
+          font.destory(_ft_mutex);
+        throw_if(true, "[TextEngine] {} is already exist", name);
+      }
+      add_font(std::move(fonts[i]));
     }
   }
-  return {};
 }
 
-auto TextEngine::get_cached_glyph_info(uint32_t unicode, type::FontStyle style) -> GlyphInfo*
+void TextEngine::evict_old_texts()
 {
-  // promise cached
-  assert(glyph_infos_has(unicode, style) || missing_glyphs_has(unicode, style));
-  auto& infos = _glyph_infos[style];
-  if (auto it = infos.find(unicode); it != infos.end())
-    return &it->second;
-  return &_glyph_infos[type::FontStyle::regular].at(Missing_Glyph_Unicode);
+  // references of shaped texts and paragraphs are only used in frame which gets them
+  // prepared ones are not drawn yet, such as next lines of dialogue
+  auto is_old = [this](auto const& pair) { return !pair.second.prepared && _frame_count - pair.second.last_used > Text_Cache_Max_Age; };
+  for (auto& [_, shaped_texts] : _shaped_texts)
+    std::erase_if(shaped_texts, is_old);
+  std::erase_if(_paragraphs,      is_old);
+  std::erase_if(_ruby_paragraphs, is_old);
+
+  // evicted texts with missing glyphs need not re-shape when font is added
+  std::erase_if(_cached_texts_with_missing_glyphs, [this](auto const& pair)
+  {
+    return !_shaped_texts[pair.first].contains(pair.second);
+  });
+}
+
+void TextEngine::add_font(Font&& font)
+{
+  font._id = ++_font_count;
+  _fonts[font._style].emplace_back(std::move(font));
+
+  // texts with missing glyphs may be covered by new font, need to re-shape
+  for (auto const& [style, text] : _cached_texts_with_missing_glyphs)
+    _shaped_texts[style].erase(text);
+  _cached_texts_with_missing_glyphs.clear();
+  std::erase_if(_paragraphs, [](auto const& pair) { return pair.second.has_missing_glyphs; });
+  std::erase_if(_ruby_paragraphs, [](auto const& pair) { return pair.second.has_missing_glyphs; });
 }
 
-auto TextEngine::has_uncached_glyphs(std::u32string_view text, type::FontStyle style) -> bool
+auto TextEngine::get_size_tier(float size) noexcept -> uint32_t
 {
-  for (auto const& unicode : text)
+  for (uint32_t tier = 0; tier < Tier_Count; ++tier)
+    if (size <= Tier_Pixel_Sizes[tier] * Tier_Max_Magnification)
+      return tier;
+  return Tier_Count - 1;
+}
+
+auto TextEngine::get_cached_glyph_info(uint32_t entry_index, uint32_t size_tier) const noexcept -> GlyphInfo const&
+{
+  auto const& info = find_cached_glyph_info(entry_index, size_tier);
+  // graphics queue only waits uploads of atlases it samples
+  if (auto index = info.glyph_atlas_index & ~(MSDF_Atlas_Flag | Color_Atlas_Flag); index < _atlas_upload_values.size())
+    _sampled_upload_value = std::max(_sampled_upload_value, _atlas_upload_values[index]);
+  return info;
+}
+
+auto TextEngine::find_cached_glyph_info(uint32_t entry_index, uint32_t size_tier) const noexcept -> GlyphInfo const&
+{
+  auto const& entry = _glyphs[entry_index];
+  auto tier = entry.get_tier(size_tier);
+  if (entry.states[tier] == GlyphEntry::State::cached)
+    return entry.infos[tier];
+
+  // over budget of generation, infos of all tiers are in layout pixel size, so can substitute each other
+  for (auto lower = tier; lower-- > 0;)
+    if (entry.states[lower] == GlyphEntry::State::cached)
+      return entry.infos[lower];
+  for (auto higher = tier + 1; higher < Tier_Count; ++higher)
+    if (entry.states[higher] == GlyphEntry::State::cached)
+      return entry.infos[higher];
+  return _glyphs[_missing_glyph_index].infos[0];
+}
+
+auto TextEngine::has_uncached_glyphs(std::span<ShapedGlyph const> glyphs, uint32_t size_tier) -> bool
+{
+  for (auto const& glyph : glyphs)
   {
-    if (!glyph_infos_has(unicode, style) && !missing_glyphs_has(unicode, style) && !wait_generate_glyphs_has(unicode, style))
-    {
-      if (auto res = find_glyph(unicode, style))
-        _wait_generate_sdf_bitmap_glyphs[style].emplace(unicode, *res);
-      else
-        _missing_glyphs[style].emplace(unicode);
-    }
+    // entry is known when shaping, only need to check state of its tier
+    auto& entry = _glyphs[glyph.entry_index];
+    auto  tier  = entry.get_tier(size_tier);
+    if (entry.color && entry.states[tier] == GlyphEntry::State::cached)
+      _color_cells[entry.color_cell].last_used = _frame_count;
+    // preloaded glyph is drawn now, it goes before other preloaded ones,
+    // its request left in preload queue is skipped by state
+    if (entry.states[tier] != GlyphEntry::State::unknown &&
+        entry.states[tier] != GlyphEntry::State::preload) continue;
+
+    entry.states[tier] = GlyphEntry::State::wait_generate;
+    _wait_generate_glyphs.emplace_back(GlyphRequest{ glyph.entry_index, tier });
   }
-  return !_wait_generate_sdf_bitmap_glyphs[style].empty();
+  return !_wait_generate_glyphs.empty();
 }
 
-auto TextEngine::calculate_text_pos_info(std::string_view text, type::FontStyle style) -> std::pair<TextPosInfo, std::u32string>
+auto TextEngine::shape(std::string_view text, type::FontStyle style, TextUse use) -> ShapedText const&
 {
   assert(!text.empty());
 
+  // try to get cached shaping result
+  auto& shaped_texts = _shaped_texts[style];
+  if (auto it = shaped_texts.find(text); it != shaped_texts.end())
+  {
+    mark_used(it->second, _frame_count, use);
+    return it->second;
+  }
+
+  // uncached, shape text
   auto u32str = utf8::utf8to32(text);
+  ShapedText shaped_text;
+  shaped_text.glyphs.reserve(u32str.size());
+
+  // cache text with missing glyphs
+  if (shape_text(u32str, style, shaped_text.glyphs))
+    _cached_texts_with_missing_glyphs.emplace_back(style, text);
 
-  // try to get cached text advances
-  auto& cached_text_advances = _cached_text_advances[style];
-  if (cached_text_advances.contains(text.data())) return { cached_text_advances[text.data()], u32str };
+  shaped_text.max_ascender = _max_ascender;
+  shaped_text.max_height   = _max_height;
+  mark_used(shaped_text, _frame_count, use);
 
-  // uncached, calculate advances
-  std::vector<glm::vec2> advances;
-  advances.reserve(u32str.size());
+  return shaped_texts.emplace(text, std::move(shaped_text)).first->second;
+}
+
+auto TextEngine::shape_text(std::u32string_view text, type::FontStyle style, std::vector<ShapedGlyph>& glyphs, uint32_t cluster_offset, type::TextDirection direction) -> bool
+{
   bool has_missing_glyphs{};
+  auto vertical = direction == type::TextDirection::vertical;
 
-  // split text by script
-  for (auto const& [text, font] : split_text_by_font(u32str, style))
+  // split text by font, then every run of font by script
+  for (auto const& [run, font] : split_text_by_font(text, style))
   {
+    auto run_offset = static_cast<uint32_t>(run.data() - text.data());
+
     if (font)
     {
-      hb_buffer_reset(_hb_buffer);
-      hb_buffer_add_utf32(_hb_buffer, reinterpret_cast<uint32_t const*>(text.data()), text.size(), 0, -1);
-      hb_buffer_guess_segment_properties(_hb_buffer);
-      hb_shape(font->_hb_font, _hb_buffer, nullptr, 0);
-
-      auto glyph_positions = hb_buffer_get_glyph_positions(_hb_buffer, nullptr);
-      for (auto i = 0; i < text.size(); ++i)
-        advances.emplace_back(static_cast<float>(glyph_positions[i].x_advance) / 64, static_cast<float>(glyph_positions[i].y_advance) / 64);
+      for_each_script_run(run, [&](std::u32string_view script_run, hb_script_t script)
+      {
+        // whole text as context, clusters are indices of characters in text
+        auto buffer = shape_run(*font, text, script_run, script, direction);
+
+        uint32_t count{};
+        auto glyph_infos     = hb_buffer_get_glyph_infos(buffer, &count);
+        auto glyph_positions = hb_buffer_get_glyph_positions(buffer, nullptr);
+        glyphs.reserve(glyphs.size() + count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+          auto const& info = glyph_infos[i];
+          auto const& pos  = glyph_positions[i];
+
+          // .notdef is displayed as missing glyph
+          auto entry_index = _missing_glyph_index;
+          if (info.codepoint != 0)
+          {
+            auto [index, inserted] = _glyphs.try_emplace(font->_id, info.codepoint);
+            if (inserted)
+            {
+              _glyphs[index].font        = font;
+              _glyphs[index].glyph_index = info.codepoint;
+              _glyphs[index].min_tier    = font->get_min_tier(info.codepoint);
+              _glyphs[index].msdf        = font->_render_mode == type::FontRenderMode::msdf;
+              _glyphs[index].color       = font->is_color_glyph(info.codepoint);
+            }
+            entry_index = index;
+          }
+
+          // harfbuzz y axis is up, but screen y axis is down
+          glyphs.emplace_back(ShapedGlyph
+          {
+            .entry_index = entry_index,
+            .cluster     = cluster_offset + info.cluster,
+            .advance     = { static_cast<float>(pos.x_advance) / 64, -static_cast<float>(pos.y_advance) / 64 },
+            .offset      = { static_cast<float>(pos.x_offset)  / 64, -static_cast<float>(pos.y_offset)  / 64 },
+          });
+        }
+      });
     }
     // if not have font, the text is missing glyphs
     else
     {
       has_missing_glyphs = true;
-      static auto missing_glyph_position_info = glm::vec2{ Missing_Glyph_Advance_X * Missing_Glyph_Size / Font::Pixel_Size,
-                                                           Missing_Glyph_Advance_Y * Missing_Glyph_Size / Font::Pixel_Size };
-      advances.resize(advances.size() + text.size(), missing_glyph_position_info);
-      continue;
+      static auto missing_glyph_advance = glm::vec2{ Missing_Glyph_Advance_X * Missing_Glyph_Size / Font::Pixel_Size,
+                                                     Missing_Glyph_Advance_Y * Missing_Glyph_Size / Font::Pixel_Size };
+      // vertical missing glyph is centered in column and advances its width
+      auto advance = vertical ? glm::vec2{ 0, missing_glyph_advance.x } : missing_glyph_advance;
+      auto offset  = vertical ? glm::vec2{ -missing_glyph_advance.x / 2, Missing_Glyph_Font_Ascender } : glm::vec2{};
+      for (uint32_t i = 0; i < run.size(); ++i)
+        glyphs.emplace_back(ShapedGlyph
+        {
+          .entry_index = _missing_glyph_index,
+          .cluster     = cluster_offset + run_offset + i,
+          .advance     = advance,
+          .offset      = offset,
+        });
     }
   }
 
-  if (has_missing_glyphs) 
+  // update max info
+  if (has_missing_glyphs)
   {
-    // cache text with missing glyphs
-    _cached_texts_with_missing_glyphs.emplace_back(style, text.data());
-    // update max info
     _max_ascender = std::max(_max_ascender, Missing_Glyph_Font_Ascender);
     _max_height   = std::max(_max_height, Missing_Glyph_Font_Height);
   }
 
-  auto res = TextPosInfo{ advances, _max_ascender, _max_height };
+  return has_missing_glyphs;
+}
+
+auto TextEngine::shape_run(Font const& font, std::u32string_view text, std::u32string_view run, hb_script_t script, type::TextDirection direction) -> hb_buffer_t*
+{
+  auto buffer = get_hb_buffer();
+  hb_buffer_reset(buffer);
+  hb_buffer_add_utf32(buffer, reinterpret_cast<uint32_t const*>(text.data()), text.size(), run.data() - text.data(), run.size());
+
+  // offsets of vertical glyphs are from vertical origin to horizontal origin
+  auto vertical = direction == type::TextDirection::vertical;
+  auto props    = hb_segment_properties_t{};
+  props.script    = script;
+  props.language  = hb_language_get_default();
+  props.direction = vertical ? HB_DIRECTION_TTB : hb_script_get_horizontal_direction(script);
+  // run only has common characters
+  if (props.direction == HB_DIRECTION_INVALID)
+    props.direction = HB_DIRECTION_LTR;
+  hb_buffer_set_segment_properties(buffer, &props);
+
+  auto features = vertical ? std::span<hb_feature_t const>{ Vertical_Features } : std::span<hb_feature_t const>{};
+  hb_shape_plan_execute(get_shape_plan(font, props, features), font._hb_font, buffer, features.data(), features.size());
+  return buffer;
+}
+
+auto TextEngine::get_shape_plan(Font const& font, hb_segment_properties_t const& props, std::span<hb_feature_t const> features) -> hb_shape_plan_t*
+{
+  std::lock_guard lock(_shape_plans_mutex);
+  auto& plan = _shape_plans[{ font._id, props.script, props.direction }];
+  if (!plan)
+    plan = hb_shape_plan_create(hb_font_get_face(font._hb_font), &props, features.data(), features.size(), nullptr);
+  return plan;
+}
+
+auto TextEngine::layout_paragraph(std::string_view text, type::FontStyle style, float max_width, type::TextDirection direction, TextUse use) -> Paragraph const&
+{
+  assert(!text.empty());
+
+  auto key = ParagraphKeyView{ text, max_width, style, direction };
+  if (auto it = _paragraphs.find(key); it != _paragraphs.end())
+  {
+    mark_used(it->second, _frame_count, use);
+    return it->second;
+  }
+
+  // text is appended to last drawn paragraph, such as typewriter,
+  // only last line need to be re-shaped and re-broken
+  auto const& last = _last_paragraph_key;
+  if (use == TextUse::draw && last.style == style && last.max_width == max_width && last.direction == direction &&
+      text.size() > last.text.size() && text.starts_with(last.text))
+  {
+    if (auto node = _paragraphs.extract(last); !node.empty())
+    {
+      auto& paragraph = node.mapped();
+      auto  begin     = paragraph.last_line_begin();
+      auto  last_line = paragraph.lines.empty() ? 0 : static_cast<uint32_t>(paragraph.lines.size() - 1);
+
+      paragraph.text += utf8::utf8to32(text.substr(last.text.size()));
+      std::erase_if(paragraph.glyphs, [begin](auto const& glyph) { return glyph.cluster >= begin; });
+      auto first_glyph = static_cast<uint32_t>(paragraph.glyphs.size());
+      paragraph.has_missing_glyphs |= shape_text(std::u32string_view{ paragraph.text }.substr(begin), style, paragraph.glyphs, begin, direction);
+      paragraph.max_ascender = std::max(paragraph.max_ascender, _max_ascender);
+      paragraph.max_height   = std::max(paragraph.max_height, _max_height);
+      paragraph.update_advances(first_glyph);
+      paragraph.layout(last_line);
+      mark_used(paragraph, _frame_count, use);
+
+      node.key()          = { std::string{ text }, max_width, style, direction };
+      _last_paragraph_key = node.key();
+      return _paragraphs.insert(std::move(node)).position->second;
+    }
+  }
 
-  // cached calculate result
-  cached_text_advances.emplace(text.data(), res);
+  // uncached, shape and break whole text
+  Paragraph paragraph;
+  paragraph.direction = direction;
+  paragraph.text      = utf8::utf8to32(text);
+  paragraph.max_width = max_width;
+  paragraph.glyphs.reserve(paragraph.text.size());
+  paragraph.has_missing_glyphs = shape_text(paragraph.text, style, paragraph.glyphs, 0, direction);
+  paragraph.max_ascender       = _max_ascender;
+  paragraph.max_height         = _max_height;
+  paragraph.update_advances();
+  paragraph.layout();
+  mark_used(paragraph, _frame_count, use);
+
+  auto it = _paragraphs.emplace(ParagraphKey{ std::string{ text }, max_width, style, direction }, std::move(paragraph)).first;
+  if (use == TextUse::draw) _last_paragraph_key = it->first;
+  return it->second;
+}
 
-  return { res, u32str };
+auto TextEngine::layout_ruby_paragraph(std::string_view text, type::FontStyle style, float max_width) -> Paragraph const&
+{
+  assert(!text.empty());
+
+  auto key = ParagraphKeyView{ text, max_width, style };
+  if (auto it = _ruby_paragraphs.find(key); it != _ruby_paragraphs.end())
+  {
+    it->second.last_used = _frame_count;
+    return it->second;
+  }
+
+  // rubies are views of source text, which only lives in this function
+  auto source = utf8::utf8to32(text);
+  std::vector<RubyNotation> notations;
+
+  Paragraph paragraph;
+  paragraph.text      = parse_ruby_notation(source, notations);
+  paragraph.max_width = max_width;
+  paragraph.glyphs.reserve(paragraph.text.size());
+  paragraph.has_missing_glyphs = shape_text(paragraph.text, style, paragraph.glyphs);
+  paragraph.max_ascender       = _max_ascender;
+  paragraph.max_height         = _max_height;
+  paragraph.last_used          = _frame_count;
+
+  paragraph.rubies.reserve(notations.size());
+  for (auto const& notation : notations)
+  {
+    auto& ruby = paragraph.rubies.emplace_back(Ruby{ notation.begin, notation.end });
+    paragraph.has_missing_glyphs |= shape_text(notation.ruby, style, ruby.glyphs);
+    ruby.max_ascender             = _max_ascender;
+    for (auto const& glyph : ruby.glyphs)
+      ruby.width += glyph.advance.x * Ruby::Ruby_Scale;
+
+    // ruby wider than base, spread base glyphs evenly with half space at both ends
+    auto first = std::ranges::partition_point(paragraph.glyphs, [&](auto const& glyph) { return glyph.cluster < ruby.begin; });
+    auto last  = std::ranges::partition_point(paragraph.glyphs, [&](auto const& glyph) { return glyph.cluster < ruby.end; });
+    auto base_width = 0.f;
+    for (auto it = first; it != last; ++it)
+      base_width += it->advance.x;
+    if (first != last && ruby.width > base_width)
+    {
+      auto space = (ruby.width - base_width) / (last - first);
+      for (auto it = first; it != last; ++it)
+      {
+        it->advance.x += space;
+        it->offset.x  += space / 2;
+      }
+    }
+  }
+  paragraph.update_advances();
+  paragraph.layout();
+
+  return _ruby_paragraphs.emplace(ParagraphKey{ std::string{ text }, max_width, style }, std::move(paragraph)).first->second;
 }
 
 auto TextEngine::split_text_by_font(std::u32string_view text, type::FontStyle style) -> std::vector<std::pair<std::u32string_view, Font*>>
@@ -359,31 +986,47 @@ auto TextEngine::split_text_by_font(std::u32string_view text, type::FontStyle st
 
 auto TextEngine::find_suitable_font(uint32_t unicode, type::FontStyle style) -> Font*
 {
-  if (auto it = std::ranges::find_if(_fonts[style], [unicode](auto& font) { return font.find_glyph(unicode); });
-      it != _fonts[style].end())
+  auto& fonts = _fonts[style];
+  if (auto it = std::ranges::find_if(fonts, [unicode](auto const& font) { return font.find_glyph(unicode); });
+      it != fonts.end())
       return &*it;
   return {};
 }
 
-auto TextEngine::wait_generate_glyphs_size() const noexcept -> uint32_t
-{
-  uint32_t size{};
-  for (auto const& [_, glyphs] : _wait_generate_sdf_bitmap_glyphs)
-    size += glyphs.size();
-  return size;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 ///                                 Font
 ////////////////////////////////////////////////////////////////////////////////
 
-auto Font::create(FT_Library ft, std::string_view path) -> Font
+auto Font::create(FT_Library ft, std::mutex& ft_mutex, std::string_view path, type::FontRenderMode render_mode, uint32_t face_index) -> Font
 {
   Font font;
-  font._name = path;
-  check(FT_New_Face(ft, path.data(), 0, &font._face), "failed to load font");
-  check(FT_Set_Pixel_Sizes(font._face, 0, Pixel_Size), "failed to set pixel size");
-  font._hb_font = hb_ft_font_create(font._face, nullptr);
+  font._name        = path;
+  font._render_mode = render_mode;
+  font._face_index  = face_index;
+
+  // face reads font data from mapped file directly
+  font._file = util::MappedFile::open(path);
+  try
+  {
+    font.open_face(ft, ft_mutex, font._face, font._sizes);
+  }
+  catch (std::exception const&)
+  {
+    font._file.close();
+    throw;
+  }
+
+  // harfbuzz reads tables of mapped file directly and scales them to layout pixel size,
+  // so shaping not depends on active size of face and can run on other threads
+  auto blob     = hb_blob_create(reinterpret_cast<char const*>(font._file.data()), font._file.size(), HB_MEMORY_MODE_READONLY, nullptr, nullptr);
+  auto hb_face  = hb_face_create(blob, font._face_index);
+  font._hb_font = hb_font_create(hb_face);
+  hb_face_destroy(hb_face);
+  hb_blob_destroy(blob);
+  hb_font_set_scale(font._hb_font, Pixel_Size * 64, Pixel_Size * 64);
+
+  // build codepoint coverage from cmap for fast font fallback
+  font._coverage.build(font._face);
 
   font._ascender = static_cast<float>(font._face->ascender) * Pixel_Size / font._face->units_per_EM;
   font._height   = static_cast<float>(font._face->height)   * Pixel_Size / font._face->units_per_EM;
@@ -411,28 +1054,122 @@ auto Font::create(FT_Library ft, std::string_view path) -> Font
   return font;
 }
 
-void Font::destory()
+void Font::open_face(FT_Library ft, std::mutex& ft_mutex, FT_Face& face, std::array<FT_Size, TextEngine::Tier_Count>& sizes)
 {
-  hb_font_destroy(_hb_font);
-  check(FT_Done_Face(_face), "failed to destroy font");
+  FT_Error err{};
+  {
+    std::lock_guard lock(ft_mutex);
+    err = FT_New_Memory_Face(ft, _file.data(), _file.size(), _face_index, &face);
+  }
+  check(err, "failed to load font");
+
+  // face is done when setting its sizes failed, sizes are done with it
+  try
+  {
+    set_face_sizes(face, sizes);
+  }
+  catch (std::exception const&)
+  {
+    {
+      std::lock_guard lock(ft_mutex);
+      FT_Done_Face(face);
+    }
+    face = {};
+    sizes.fill({});
+    throw;
+  }
 }
 
-auto Font::find_glyph(uint32_t unicode) noexcept -> uint32_t
+void Font::set_face_sizes(FT_Face face, std::array<FT_Size, TextEngine::Tier_Count>& sizes)
 {
-  return FT_Get_Char_Index(_face, unicode);
+  if (FT_IS_SCALABLE(face))
+  {
+    check(FT_Set_Pixel_Sizes(face, 0, Pixel_Size), "failed to set pixel size");
+
+    // every tier has its own size object, default size of face is used by first tier and shaping
+    sizes[0] = face->size;
+    for (uint32_t tier = 1; tier < TextEngine::Tier_Count; ++tier)
+    {
+      check(FT_New_Size(face, &sizes[tier]), "failed to create size");
+      check(FT_Activate_Size(sizes[tier]), "failed to activate size");
+      check(FT_Set_Pixel_Sizes(face, 0, TextEngine::Tier_Pixel_Sizes[tier]), "failed to set pixel size");
+    }
+    check(FT_Activate_Size(sizes[0]), "failed to activate size");
+  }
+  else
+  {
+    // bitmap only font (cbdt emoji) has fixed strikes, use smallest one not less than colour tier
+    check(!FT_HAS_FIXED_SIZES(face), "font has neither outlines nor bitmap strikes");
+    auto strike = 0;
+    for (auto i = 1; i < face->num_fixed_sizes; ++i)
+    {
+      auto size = face->available_sizes[i].y_ppem, best = face->available_sizes[strike].y_ppem;
+      auto min  = static_cast<FT_Pos>(TextEngine::Tier_Pixel_Sizes[TextEngine::Color_Glyph_Tier]) << 6;
+      if (best < min ? size > best : size >= min && size < best)
+        strike = i;
+    }
+    check(FT_Select_Size(face, strike), "failed to select strike");
+    sizes.fill(face->size);
+  }
 }
 
-auto Font::generate_sdf_bitmap(uint32_t glyph_index, uint32_t unicode, type::FontStyle style) -> SDFBitmap
+void Font::open_prepare_face(FT_Library ft, std::mutex& ft_mutex)
 {
-  assert(glyph_index != 0);
-  check(FT_Load_Glyph(_face, glyph_index, FT_LOAD_RENDER), "failed to load glyph with render");
-  auto glyph = _face->glyph;
-  check(FT_Render_Glyph(glyph, FT_RENDER_MODE_SDF), "failed to render sdf bitmap");
-  auto ft_bitmap = _face->glyph->bitmap;
+  if (!_prepare_face)
+    open_face(ft, ft_mutex, _prepare_face, _prepare_sizes);
+}
+
+void Font::destory(std::mutex& ft_mutex)
+{
+  hb_font_destroy(_hb_font);
+  {
+    std::lock_guard lock(ft_mutex);
+    check(FT_Done_Face(_face), "failed to destroy font");
+    if (_prepare_face)
+      check(FT_Done_Face(_prepare_face), "failed to destroy font");
+  }
+  _file.close();
+}
+
+auto Font::generate_sdf_bitmap(uint32_t glyph_index, uint32_t tier, bool prepare) -> SDFBitmap
+{
+  assert(glyph_index != 0 && tier < TextEngine::Tier_Count);
+
+  // preparation thread renders by its own face
+  auto        face  = prepare ? _prepare_face : _face;
+  auto const& sizes = prepare ? _prepare_sizes : _sizes;
+
+  // render in size of tier, then restore default size for shaping
+  check(FT_Activate_Size(sizes[tier]), "failed to activate size");
+
+  // msdf is generated from unhinted outline
+  if (_render_mode == type::FontRenderMode::msdf)
+  {
+    auto err = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING);
+    FT_Activate_Size(sizes[0]);
+    check(err, "failed to load glyph outline");
+
+    SDFBitmap bitmap;
+    bitmap.render_mode = type::FontRenderMode::msdf;
+    if (face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+      return bitmap;
+    auto msdf = generate_msdf(face->glyph->outline);
+    bitmap.data        = std::move(msdf.data);
+    bitmap.extent      = { msdf.width, msdf.height };
+    bitmap.left_offset = msdf.left;
+    bitmap.up_offset   = -msdf.top;
+    return bitmap;
+  }
+
+  auto err = FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER);
+  if (!err) err = FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF);
+  FT_Activate_Size(sizes[0]);
+  check(err, "failed to render sdf bitmap");
+
+  auto glyph = face->glyph;
+  auto ft_bitmap = face->glyph->bitmap;
   SDFBitmap bitmap;
   bitmap.extent      = { ft_bitmap.width, ft_bitmap.rows };
-  bitmap.unicode     = unicode;
-  bitmap.style       = style;
   bitmap.left_offset = glyph->bitmap_left;
   bitmap.up_offset   = -glyph->bitmap_top;
   bitmap.data.resize(bitmap.extent.x * bitmap.extent.y);
@@ -440,4 +1177,100 @@ auto Font::generate_sdf_bitmap(uint32_t glyph_index, uint32_t unicode, type::Fon
   return bitmap;
 }
 
+auto Font::is_color_glyph(uint32_t glyph_index) -> bool
+{
+  if (!FT_HAS_COLOR(_face)) return false;
+  if (!FT_IS_SCALABLE(_face)) return true;
+
+  FT_UInt          layer_glyph_index{};
+  FT_UInt          layer_color_index{};
+  FT_LayerIterator iterator{};
+  return FT_Get_Color_Glyph_Layer(_face, glyph_index, &layer_glyph_index, &layer_color_index, &iterator);
+}
+
+auto Font::generate_color_bitmap(uint32_t glyph_index, bool prepare) -> SDFBitmap
+{
+  assert(glyph_index != 0);
+
+  // preparation thread renders by its own face
+  auto        face  = prepare ? _prepare_face : _face;
+  auto const& sizes = prepare ? _prepare_sizes : _sizes;
+
+  // freetype blends colr layers or decodes png of strike to bgra bitmap
+  check(FT_Activate_Size(sizes[TextEngine::Color_Glyph_Tier]), "failed to activate size");
+  auto err  = FT_Load_Glyph(face, glyph_index, FT_LOAD_COLOR | FT_LOAD_RENDER);
+  auto ppem = face->size->metrics.y_ppem;
+  FT_Activate_Size(sizes[0]);
+  check(err, "failed to render colour glyph");
+
+  SDFBitmap bitmap;
+  bitmap.color = true;
+  auto const& src = face->glyph->bitmap;
+  if (src.width == 0 || src.rows == 0 || ppem == 0)
+    return bitmap;
+
+  // strike may be bigger than colour tier, and bitmap should fit in cell
+  constexpr auto pixel_size = static_cast<float>(TextEngine::Tier_Pixel_Sizes[TextEngine::Color_Glyph_Tier]);
+  constexpr auto cell_size  = static_cast<float>(TextEngine::Color_Cell_Size);
+  auto scale  = std::min({ pixel_size / ppem, cell_size / src.width, cell_size / src.rows, 1.f });
+  auto width  = std::clamp(static_cast<uint32_t>(std::ceil(src.width * scale)), 1u, TextEngine::Color_Cell_Size);
+  auto height = std::clamp(static_cast<uint32_t>(std::ceil(src.rows  * scale)), 1u, TextEngine::Color_Cell_Size);
+  bitmap.extent      = { width, height };
+  bitmap.left_offset = face->glyph->bitmap_left * scale;
+  bitmap.up_offset   = -face->glyph->bitmap_top * scale;
+  bitmap.data.resize(width * height * 4);
+
+  // average source texels covered by every texel, bgra of freetype is premultiplied and atlas keeps it
+  auto bgra = src.pixel_mode == FT_PIXEL_MODE_BGRA;
+  for (uint32_t y = 0; y < height; ++y)
+  {
+    auto y0 = static_cast<uint32_t>(y / scale);
+    auto y1 = std::clamp(static_cast<uint32_t>((y + 1) / scale), y0 + 1, src.rows);
+    for (uint32_t x = 0; x < width; ++x)
+    {
+      auto x0 = static_cast<uint32_t>(x / scale);
+      auto x1 = std::clamp(static_cast<uint32_t>((x + 1) / scale), x0 + 1, src.width);
+
+      std::array<uint32_t, 4> sum{};
+      for (auto sy = y0; sy < y1; ++sy)
+      {
+        auto row = src.buffer + static_cast<ptrdiff_t>(sy) * src.pitch;
+        for (auto sx = x0; sx < x1; ++sx)
+        {
+          // glyph without colour in colour font is white
+          if (bgra)
+          {
+            sum[0] += row[sx * 4 + 2];
+            sum[1] += row[sx * 4 + 1];
+            sum[2] += row[sx * 4 + 0];
+            sum[3] += row[sx * 4 + 3];
+          }
+          else
+            for (auto& channel : sum)
+              channel += row[sx];
+        }
+      }
+      auto count = (y1 - y0) * (x1 - x0);
+      auto out   = bitmap.data.data() + (y * width + x) * 4;
+      for (uint32_t i = 0; i < 4; ++i)
+        out[i] = static_cast<uint8_t>((sum[i] + count / 2) / count);
+    }
+  }
+  return bitmap;
+}
+
+auto Font::get_min_tier(uint32_t glyph_index) -> uint32_t
+{
+  // only need outline in font units, not scale and render
+  if (FT_Load_Glyph(_face, glyph_index, FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING) ||
+      _face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+    return 0;
+
+  auto point_count = static_cast<uint32_t>(_face->glyph->outline.n_points);
+  uint32_t tier{};
+  while (tier + 1 < TextEngine::Tier_Count && point_count >= TextEngine::Tier_Min_Point_Counts[tier + 1])
+    ++tier;
+  return tier;
+}
+
 }}
\ No newline at end of file
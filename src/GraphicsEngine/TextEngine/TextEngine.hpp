@@ -6,6 +6,36 @@
 // use have responsibility to load all styles for font (italic, bold, italic bold)
 // unless them never use styles they not load
 //
+// sdf bitmaps have several resolution tiers, and each tier has its own glyph atlases.
+// tier of glyph is decided by complexity of its outline and render size,
+// so simple glyphs in body text use small tier and complex glyphs or large titles use big tier.
+//
+// font can generate msdf bitmaps instead of sdf, which are stored in rgba glyph atlases.
+// msdf keeps sharp corners, so it is magnified more and uses smaller tier than sdf.
+//
+// colour glyphs (colr layers or bitmap emoji) are rasterized once in size of colour tier,
+// and stored in fixed cells of a rgba glyph atlas. when all cells are used,
+// least recently drawn glyph is evicted, unless it may still be sampled by frames in flight.
+//
+// sdf bitmaps are generated in a time budget of every frame, glyphs to draw go first,
+// then preloaded glyphs use rest of budget. glyph over budget is drawn by its cached
+// lower tier or missing glyph until its bitmap is generated in later frames.
+//
+// text is split by font and script, every run is shaped by cached shape plan of its font, script and direction.
+// harfbuzz reads font tables from mapped file, and every thread has its own buffer, so shape_run is thread safe.
+// rest of shaping looks up and inserts glyph entries, which is only on main thread.
+//
+// texts known in advance, such as next lines of dialogue, can be prepared. they are shaped and laid out,
+// and bitmaps of their glyphs are generated on preparation thread by its own faces,
+// then uploaded at frame begin after finished, so drawing them later costs same as cached texts.
+//
+// vertical text is shaped in top to bottom direction with vert and vrt2 features,
+// its advances and offsets are from vertical metrics of font.
+//
+// font files are memory mapped, and can be parsed on worker thread,
+// loaded fonts are published together at frame begin.
+// freetype library is shared, so creating and destroying faces are serialized by mutex.
+//
 
 #pragma once
 
@@ -18,41 +48,116 @@
 #include <vector>
 #include <span>
 #include <unordered_map>
-#include <unordered_set>
-#include <optional>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <exception>
 
 #include "../MemoryAllocator.hpp"
+#include "../Barrier.hpp"
+#include "../TransferQueue.hpp"
 #include "../types.hpp"
+#include "../../MappedFile.hpp"
+#include "GlyphCoverage.hpp"
+#include "GlyphTable.hpp"
+#include "MSDF.hpp"
+#include "TextLayout.hpp"
 #include "tk/type.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define TK_SSE2
+  #include <emmintrin.h>
+#endif
+
 namespace tk { namespace graphics_engine {
 
   struct SDFBitmap
   {
     std::vector<uint8_t> data;
     glm::vec2            extent{};
-    uint32_t             unicode{ std::numeric_limits<uint32_t>::max() };
-    type::FontStyle      style{};
     float                left_offset{};
     float                up_offset{};
+    type::FontRenderMode render_mode{};
+    bool                 color{};       // premultiplied rgba of colour glyph
+
+    auto channel_count() const noexcept -> uint32_t { return color || render_mode == type::FontRenderMode::msdf ? 4 : 1; }
 
     auto valid() const noexcept
     { 
-      return unicode != std::numeric_limits<uint32_t>::max() &&
-             !data.empty()                                   &&
-             extent.x > 0                                    &&
+      return !data.empty() &&
+             extent.x > 0  &&
              extent.y > 0;
     }
   };
 
-  struct TextPosInfo
+  // how cached text is used, prepared text is not evicted until it is drawn
+  enum class TextUse : uint8_t
+  {
+    draw,
+    measure,  // keeps prepared state
+    prepare,
+  };
+
+  struct ShapedText
+  {
+    std::vector<ShapedGlyph> glyphs;
+    float                    max_ascender{};
+    float                    max_height{};
+    uint64_t                 last_used{};  // frame count of text engine, text not used for long is evicted
+    bool                     prepared{};   // prepared and not drawn yet
+  };
+
+  // texts are looked up by string view, no string is built for cached text
+  struct TextHash
+  {
+    using is_transparent = void;
+
+    auto operator()(std::string_view text) const noexcept -> size_t { return std::hash<std::string_view>{}(text); }
+  };
+
+  // glyph of specific tier need to be generated
+  struct GlyphRequest
+  {
+    uint32_t entry_index{};
+    uint32_t tier{};
+  };
+
+  // bitmap generated on preparation thread
+  struct PreparedGlyph
+  {
+    GlyphRequest       request;
+    SDFBitmap          bitmap;
+    std::exception_ptr error;   // generation failed, glyph is generated again when it is drawn
+  };
+
+  struct ShapePlanKey
   {
-    std::vector<glm::vec2> advances;
-    float                  max_ascender{};
-    float                  max_height{};
+    uint32_t       font_id{};
+    hb_script_t    script{};
+    hb_direction_t direction{};
+
+    auto operator==(ShapePlanKey const&) const noexcept -> bool = default;
+  };
+
+  struct ShapePlanKeyHash
+  {
+    auto operator()(ShapePlanKey const& key) const noexcept -> size_t
+    {
+      auto hash = std::hash<uint32_t>{}(key.font_id);
+      hash ^= static_cast<size_t>(key.script)    + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= static_cast<size_t>(key.direction) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      return hash;
+    }
   };
 
   struct GlyphInfo;
+  struct GlyphEntry;
   class Font;
   class TextEngine
   {
@@ -60,79 +165,219 @@ namespace tk { namespace graphics_engine {
     static constexpr auto Glyph_Atlas_Width  = 2048;
     static constexpr auto Glyph_Atlas_Height = Glyph_Atlas_Width;
 
-    void init(MemoryAllocator& alloc);
+    // pixel sizes of sdf bitmap tiers, first one is also pixel size of layout
+    static constexpr std::array<uint32_t, 3> Tier_Pixel_Sizes{ 32, 64, 128 };
+    static constexpr uint32_t                Tier_Count = Tier_Pixel_Sizes.size();
+    // outline point count from which glyph needs bigger tier
+    static constexpr std::array<uint32_t, 3> Tier_Min_Point_Counts{ 0, 100, 250 };
+    // max magnification of render size to tier pixel size
+    static constexpr float                   Tier_Max_Magnification = 2.f;
+
+    static constexpr uint32_t Render_Mode_Count = 2;
+    // set on glyph atlas index of vertex when glyph is in msdf atlas
+    static constexpr uint32_t MSDF_Atlas_Flag   = 0x80000000;
+    // set on glyph atlas index of vertex when glyph is in colour atlas
+    static constexpr uint32_t Color_Atlas_Flag  = 0x40000000;
+
+    // colour glyphs are rasterized in pixel size of this tier, and every one uses a cell of colour atlas
+    static constexpr uint32_t Color_Glyph_Tier  = 1;
+    static constexpr uint32_t Color_Cell_Size   = 80;
+    static constexpr uint32_t Color_Cell_Count  = (Glyph_Atlas_Width / Color_Cell_Size) * (Glyph_Atlas_Height / Color_Cell_Size);
+
+    static constexpr std::chrono::duration<float, std::milli> Default_Generation_Budget{ 4.f };
+
+    // cached texts and paragraphs not used in these frames are evicted, checked once every interval
+    static constexpr uint32_t Text_Cache_Max_Age        = 600;
+    static constexpr uint32_t Text_Cache_Evict_Interval = 60;
+
+    // font id of glyphs not from font files, such as missing glyph
+    static constexpr uint32_t Builtin_Font_Id  = 0;
+    static constexpr uint32_t Missing_Glyph_Id = 0;
+
+    // frame count decides when evicted colour glyph is not sampled by frames in flight
+    // glyphs are uploaded by transfer queue if it is not null
+    void init(MemoryAllocator& alloc, uint32_t frame_count, TransferQueue* transfer_queue = nullptr);
     void destroy();
 
     // return true, need to expand descriptors because of new glyph atlases be created
-    auto frame_begin(Command const& cmd) -> bool;
+    // transitions of atlases to shader read are added to barriers, flushed before rendering
+    auto frame_begin(Command const& cmd, BarrierBatch& barriers) -> bool;
 
-    void preload_glyphs(Command const& cmd);
-    void calculate_write_position(glm::vec2 const& extent);
-    void upload_glyphs(std::span<SDFBitmap> bitmaps);
-    void upload_glyph(Command const& cmd, uint32_t unicode, uint8_t const* data, glm::vec2 extent, float left_offset, float up_offset, type::FontStyle style);
+    void preload_builtin_glyphs(Command const& cmd);
+    void calculate_write_position(glm::vec2 const& extent, uint32_t tier = 0, type::FontRenderMode render_mode = type::FontRenderMode::sdf);
+    void upload_glyphs(std::span<SDFBitmap const> bitmaps, std::span<GlyphRequest const> requests);
+    void upload_glyph(Command const& cmd, uint32_t entry_index, uint8_t const* data, glm::vec2 extent, float left_offset, float up_offset);
+    // record copies of this frame to transfer queue and submit
+    void upload_by_transfer_queue();
+    auto find_cached_glyph_info(uint32_t entry_index, uint32_t size_tier) const noexcept -> GlyphInfo const&;
 
-    void load_font(std::string_view path);
+    void load_font(std::string_view path, type::FontRenderMode render_mode = type::FontRenderMode::sdf);
+    // parse fonts on worker thread, they are published together at frame begin after all loaded
+    void load_fonts_async(std::vector<std::string> paths, type::FontRenderMode render_mode = type::FontRenderMode::sdf);
+    auto is_loading_fonts() const noexcept { return !_font_loadings.empty(); }
     
     auto get_glyph_atlases() const noexcept { return _glyph_atlases; }
+    // atlases uploaded by transfer queue keep general layout, so they are sampled while other regions are written
+    auto get_glyph_atlas_layout() const noexcept { return _transfer_queue ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; }
+    // value of transfer semaphore which graphics queue waits before sampling atlases used by this frame
+    auto take_sampled_upload_value() noexcept { return std::exchange(_sampled_upload_value, 0); }
+
+    // smallest tier which can be magnified to render size
+    static auto get_size_tier(float size) noexcept -> uint32_t;
 
-    auto has_uncached_glyphs(std::u32string_view text, type::FontStyle style) -> bool;
-    auto get_cached_glyph_info(uint32_t unicode, type::FontStyle style) -> GlyphInfo*;
-    void generate_sdf_bitmaps();
+    // also marks colour glyphs are used in this frame
+    auto has_uncached_glyphs(std::span<ShapedGlyph const> glyphs, uint32_t size_tier) -> bool;
+    // glyph not generated yet is substituted by its cached lower tier, higher tier or missing glyph
+    // also records uploads of its atlas need to be waited
+    auto get_cached_glyph_info(uint32_t entry_index, uint32_t size_tier) const noexcept -> GlyphInfo const&;
+    /**
+     * generate bitmaps of waiting glyphs until budget of this frame is used up
+     * @param preload also generate preloaded glyphs after glyphs to draw
+     */
+    void generate_sdf_bitmaps(bool preload = false);
 
-    auto find_glyph(uint32_t unicode, type::FontStyle style) -> std::optional<std::pair<std::reference_wrapper<Font>, uint32_t>>;
+    /**
+     * queue glyphs of text to generate in rest budget of frames
+     * @param text such as character set of a script
+     * @param style
+     * @param size_tier
+     */
+    void preload_glyphs(std::string_view text, type::FontStyle style, uint32_t size_tier);
+    void set_generation_budget(std::chrono::duration<float, std::milli> budget) noexcept { _generation_budget = budget; }
+
+    /**
+     * shape and lay out texts to draw later, bitmaps of their uncached glyphs are generated on preparation thread
+     * @param texts
+     * @param style
+     * @param size render size
+     * @param max_width 0 for single line text, otherwise width of paragraph in pixel size of font
+     * @param direction direction of paragraph
+     * @note prepared texts are kept in cache until they are drawn, so only texts which will be drawn should be prepared
+     */
+    void prepare_texts(std::span<std::string_view const> texts, type::FontStyle style, float size, float max_width = 0.f,
+                       type::TextDirection direction = type::TextDirection::horizontal);
+
+    // get cached shaping result of single line text
+    auto shape(std::string_view text, type::FontStyle style, TextUse use = TextUse::draw) -> ShapedText const&;
+
+    /**
+     * shape text by harfbuzz, every run use its suitable font
+     * @param text
+     * @param style
+     * @param glyphs shaped glyphs are appended to it, cluster is index of character in text
+     * @param cluster_offset offset add to every cluster
+     * @param direction vertical glyphs advance along y axis, offset from center of column top
+     * @return true if text has missing glyphs
+     */
+    auto shape_text(std::u32string_view text, type::FontStyle style, std::vector<ShapedGlyph>& glyphs, uint32_t cluster_offset = 0,
+                    type::TextDirection direction = type::TextDirection::horizontal) -> bool;
     
-    auto calculate_text_pos_info(std::string_view text, type::FontStyle style) -> std::pair<TextPosInfo, std::u32string>;
+    /**
+     * get line broken paragraph, which is cached by text, max width, style and direction
+     * when text is extended from last drawn paragraph, only its last line be re-shaped and re-broken
+     * @param text
+     * @param style
+     * @param max_width width of box in pixel size of font, height of box for vertical text
+     * @param direction
+     * @param use measuring and preparing neither extend nor replace last drawn paragraph
+     */
+    auto layout_paragraph(std::string_view text, type::FontStyle style, float max_width,
+                          type::TextDirection direction = type::TextDirection::horizontal, TextUse use = TextUse::draw) -> Paragraph const&;
+
+    /**
+     * get line broken horizontal paragraph with ruby notations, base and rubies are shaped together and cached
+     * @param text with ruby notations of aozora bunko, ｜base《ruby》 or kanji《ruby》
+     * @param style
+     * @param max_width width of box in pixel size of font
+     */
+    auto layout_ruby_paragraph(std::string_view text, type::FontStyle style, float max_width) -> Paragraph const&;
+    /**
+     * shape run of single font and script, thread safe
+     * @param font
+     * @param text context of run
+     * @param run
+     * @param script
+     * @param direction
+     * @return buffer of calling thread, which keeps result until next shaping on this thread
+     */
+    auto shape_run(Font const& font, std::u32string_view text, std::u32string_view run, hb_script_t script, type::TextDirection direction) -> hb_buffer_t*;
     auto split_text_by_font(std::u32string_view text, type::FontStyle style) -> std::vector<std::pair<std::u32string_view, Font*>>;
     auto find_suitable_font(uint32_t unicode, type::FontStyle style) -> Font*;
 
-    template <typename T>
-    static auto has(T& map, uint32_t unicode, type::FontStyle style) noexcept
-    {
-      if (map.contains(style))
-        return map[style].contains(unicode);
-      return false;
-    }
-    auto glyph_infos_has(uint32_t unicode, type::FontStyle style) noexcept
-    {
-      return has(_glyph_infos, unicode, style);
-    }
-    auto missing_glyphs_has(uint32_t unicode, type::FontStyle style) noexcept
-    {
-      return has(_missing_glyphs, unicode, style);
-    }
-    auto wait_generate_glyphs_has(uint32_t unicode, type::FontStyle style) noexcept
-    {
-      return has(_wait_generate_sdf_bitmap_glyphs, unicode, style);
-    }
-    auto wait_generate_glyphs_size() const noexcept -> uint32_t;
+    auto wait_generate_glyphs_size() const noexcept -> uint32_t { return _wait_generate_glyphs.size(); }
+
+  private:
+    auto is_font_loaded(std::string_view path) const noexcept -> bool;
+    void add_font(Font&& font);
+    void publish_loaded_fonts();
+    // upload glyphs of finished preparations
+    void upload_prepared_glyphs();
+    // evict cached texts and paragraphs not used for max age, except prepared ones not drawn yet
+    void evict_old_texts();
+    // shape plan is cached by font, script and direction, features are decided by direction
+    auto get_shape_plan(Font const& font, hb_segment_properties_t const& props, std::span<hb_feature_t const> features) -> hb_shape_plan_t*;
+    // get cell of colour atlas for glyph, return false if all cells are used by recent frames
+    auto allocate_color_cell(uint32_t entry_index) -> bool;
 
   private:
     template <typename T>
     using FontStyleMap = std::unordered_map<type::FontStyle, T>;
     template <typename T>
-    using UnicodeMap   = std::unordered_map<uint32_t, T>;
-    template <typename T>
-    using TextMap      = std::unordered_map<std::string, T>;
+    using TextMap      = std::unordered_map<std::string, T, TextHash, std::equal_to<>>;
 
     FT_Library                                            _ft;
-    FontStyleMap<std::vector<Font>>                       _fonts;
+    std::mutex                                            _ft_mutex;
+    std::vector<std::future<std::vector<Font>>>           _font_loadings;
+    std::vector<std::future<std::vector<PreparedGlyph>>>  _preparations;
+    std::mutex                                            _prepare_mutex;  // preparations run one by one
+    FontStyleMap<std::deque<Font>>                        _fonts; // deque keeps address of font stable, glyph entries refer to it
+    uint32_t                                              _font_count{};
     MemoryAllocator*                                      _mem_alloc{};
     std::vector<Image>                                    _glyph_atlases;
-    Buffer                                                _glyph_atlas_buffer;
-    glm::vec2                                             _current_write_position{};
+    StagingBuffer                                         _glyph_atlas_buffer;
     std::vector<std::pair<uint32_t, glm::vec2>>           _write_positions{};
-    float                                                 _current_line_max_glyph_height{};
-    FontStyleMap<UnicodeMap<GlyphInfo>>                   _glyph_infos;
-    FontStyleMap<UnicodeMap<std::pair<Font, uint32_t>>>   _wait_generate_sdf_bitmap_glyphs{};
-    hb_buffer_t*                                          _hb_buffer{};
-    FontStyleMap<TextMap<TextPosInfo>>                    _cached_text_advances;
+    GlyphTable<GlyphEntry>                                _glyphs;
+    std::vector<GlyphRequest>                             _wait_generate_glyphs;
+    std::deque<GlyphRequest>                              _preload_glyphs;
+    std::chrono::duration<float, std::milli>              _generation_budget{ Default_Generation_Budget };
+    std::chrono::duration<float, std::milli>              _generation_time{}; // spent in current frame
+    uint32_t                                              _missing_glyph_index{ GlyphTable<GlyphEntry>::Invalid_Index };
+    FontStyleMap<TextMap<ShapedText>>                     _shaped_texts;
     std::vector<std::pair<type::FontStyle, std::string>>  _cached_texts_with_missing_glyphs;
-    FontStyleMap<std::unordered_set<uint32_t>>            _missing_glyphs;
+    std::unordered_map<ShapePlanKey, hb_shape_plan_t*, ShapePlanKeyHash> _shape_plans;
+    std::mutex                                            _shape_plans_mutex;
+    std::unordered_map<ParagraphKey, Paragraph, ParagraphKeyHash, ParagraphKeyEqual> _paragraphs;
+    ParagraphKey                                          _last_paragraph_key;
+    std::unordered_map<ParagraphKey, Paragraph, ParagraphKeyHash, ParagraphKeyEqual> _ruby_paragraphs;
     float                                                 _max_ascender{};
     float                                                 _max_height{};
     std::unordered_map<uint32_t, std::vector<CopyRegion>> _copy_regions;
-    uint32_t                                              _current_glyph_atlas_index{};
     bool                                                  _new_glyph_atlas{};
+
+    // every tier of every render mode packs glyphs line by line to its current glyph atlas
+    struct AtlasPacker
+    {
+      uint32_t  glyph_atlas_index{ std::numeric_limits<uint32_t>::max() }; // not created yet
+      glm::vec2 write_position{};
+      float     line_max_glyph_height{};
+    };
+    std::array<std::array<AtlasPacker, Tier_Count>, Render_Mode_Count> _packers;
+
+    // cells of colour atlas, glyph of least recently used cell is evicted
+    struct ColorCell
+    {
+      uint32_t entry_index{ GlyphTable<GlyphEntry>::Invalid_Index };
+      uint64_t last_used{};  // frame count
+    };
+    std::vector<ColorCell> _color_cells;  // empty until first colour glyph
+    uint32_t               _color_atlas_index{};
+    uint64_t               _frame_count{ 1 };
+    uint32_t               _frames_in_flight{};
+
+    // asynchronous uploads
+    TransferQueue*         _transfer_queue{};
+    std::vector<uint64_t>  _atlas_upload_values;     // value of transfer semaphore of last upload to each atlas
+    mutable uint64_t       _sampled_upload_value{};  // max upload value of atlases sampled in this frame
   };
 
   class Font
@@ -140,24 +385,48 @@ namespace tk { namespace graphics_engine {
     friend class TextEngine;
 
   public:
-    // TODO: small pixel size will lead complex glyph generate sdf bitmap not right when render in big size
-    //       try use dynamic pixel size adjust by complexity of glyph
-    //       and store in different glyph size altas to save memory
-    static constexpr auto Pixel_Size = 32;
+    // pixel size of layout, bitmaps of bigger tiers are scaled to it
+    static constexpr auto Pixel_Size = TextEngine::Tier_Pixel_Sizes[0];
 
-    static auto create(FT_Library ft, std::string_view path) -> Font;
-    void destory();
+    /**
+     * @param face_index face in font collection (ttc), freetype and harfbuzz use same face
+     */
+    static auto create(FT_Library ft, std::mutex& ft_mutex, std::string_view path, type::FontRenderMode render_mode = type::FontRenderMode::sdf, uint32_t face_index = 0) -> Font;
+    void destory(std::mutex& ft_mutex);
 
-    auto find_glyph(uint32_t unicode) noexcept -> uint32_t;
-    auto generate_sdf_bitmap(uint32_t glyph_index, uint32_t unicode, type::FontStyle style) -> SDFBitmap;
+    auto find_glyph(uint32_t unicode) const noexcept -> uint32_t { return _coverage.find_glyph(unicode); }
+    // face of preparation thread is used when prepare is true
+    auto generate_sdf_bitmap(uint32_t glyph_index, uint32_t tier, bool prepare = false) -> SDFBitmap;
+    // glyph has colr layers, or font only has colour bitmaps
+    auto is_color_glyph(uint32_t glyph_index) -> bool;
+    // rasterize colour glyph in size of colour tier, bigger bitmap is scaled down to fit cell
+    auto generate_color_bitmap(uint32_t glyph_index, bool prepare = false) -> SDFBitmap;
+    // create face of preparation thread when first used, it renders glyphs parallel with face of main thread
+    void open_prepare_face(FT_Library ft, std::mutex& ft_mutex);
+    // smallest tier can keep details of glyph, decided by point count of outline
+    auto get_min_tier(uint32_t glyph_index) -> uint32_t;
 
   private:
-    std::string     _name;
-    FT_Face         _face;
-    hb_font_t*      _hb_font{};
-    type::FontStyle _style{};
-    float           _ascender{};
-    float           _height{};
+    // create face from mapped file and sizes of all tiers
+    void open_face(FT_Library ft, std::mutex& ft_mutex, FT_Face& face, std::array<FT_Size, TextEngine::Tier_Count>& sizes);
+    // sizes of all tiers, or fixed strike of bitmap only font
+    static void set_face_sizes(FT_Face face, std::array<FT_Size, TextEngine::Tier_Count>& sizes);
+
+  private:
+    std::string          _name;
+    uint32_t             _id{};
+    util::MappedFile     _file;
+    uint32_t             _face_index{};
+    FT_Face              _face;
+    std::array<FT_Size, TextEngine::Tier_Count> _sizes{}; // first one is default size of face
+    FT_Face              _prepare_face{};
+    std::array<FT_Size, TextEngine::Tier_Count> _prepare_sizes{};
+    hb_font_t*           _hb_font{};
+    type::FontStyle      _style{};
+    type::FontRenderMode _render_mode{};
+    float                _ascender{};
+    float                _height{};
+    GlyphCoverage        _coverage;
   };
 
   struct GlyphInfo
@@ -170,8 +439,17 @@ namespace tk { namespace graphics_engine {
     glm::vec2 extent{};
     glm::vec2 pos_offset{};
 
-    GlyphInfo(uint32_t glyph_atlas_index, glm::vec2 pos, glm::vec2 extent, float left_offset, float up_offset) noexcept
-      : glyph_atlas_index(glyph_atlas_index), extent(extent), pos_offset(left_offset, up_offset)
+    GlyphInfo() = default;
+    /**
+     * @param glyph_atlas_index
+     * @param pos position in atlas
+     * @param extent extent in atlas
+     * @param left_offset
+     * @param up_offset
+     * @param scale scale tier pixel size to layout pixel size
+     */
+    GlyphInfo(uint32_t glyph_atlas_index, glm::vec2 pos, glm::vec2 extent, float left_offset, float up_offset, float scale = 1.f) noexcept
+      : glyph_atlas_index(glyph_atlas_index), extent(extent * scale), pos_offset(left_offset * scale, up_offset * scale)
     {
       min_x = (pos.x + 0.5f) / TextEngine::Glyph_Atlas_Width;
       min_y = (pos.y + 0.5f) / TextEngine::Glyph_Atlas_Height;
@@ -184,33 +462,133 @@ namespace tk { namespace graphics_engine {
       return size / Font::Pixel_Size;
     }
 
-    auto get_vertices(glm::vec2 const& pos, float size, uint32_t offset, float ascender, uint32_t glyph_atlases_index) const noexcept -> std::vector<Vertex>
+    /**
+     * write 4 vertices of glyph quad
+     * @param out
+     * @param pos pen position in render pixel
+     * @param scale scale of render size to layout pixel size
+     * @param offset offset of shape property
+     * @param ascender 0 for vertical text, its offsets are from top of column
+     */
+    void write_vertices(Vertex* out, glm::vec2 const& pos, float scale, uint32_t offset, float ascender) const noexcept
+    {
+#ifdef TK_SSE2
+      write_vertices_sse2(out, pos, scale, offset, ascender);
+#else
+      write_vertices_scalar(out, pos, scale, offset, ascender);
+#endif
+    }
+
+    /**
+     * write quads of 4 glyphs, corners of them are transformed together
+     * @param out 16 vertices
+     * @param infos
+     * @param pos pen positions of glyphs
+     * @param scale
+     * @param offset
+     * @param ascender
+     */
+    static void write_vertices(Vertex* out, std::array<GlyphInfo const*, 4> const& infos, std::array<glm::vec2, 4> const& pos,
+                               float scale, uint32_t offset, float ascender) noexcept
+    {
+#ifdef TK_SSE2
+      // lanes are 4 glyphs, same operations and order as single quad, so results are bit identical
+      auto s        = _mm_set1_ps(scale);
+      auto left     = _mm_add_ps(_mm_setr_ps(pos[0].x, pos[1].x, pos[2].x, pos[3].x),
+                                 _mm_mul_ps(_mm_setr_ps(infos[0]->pos_offset.x, infos[1]->pos_offset.x, infos[2]->pos_offset.x, infos[3]->pos_offset.x), s));
+      auto top      = _mm_add_ps(_mm_setr_ps(pos[0].y, pos[1].y, pos[2].y, pos[3].y),
+                                 _mm_mul_ps(_mm_setr_ps(infos[0]->pos_offset.y, infos[1]->pos_offset.y, infos[2]->pos_offset.y, infos[3]->pos_offset.y), s));
+      top           = _mm_add_ps(top, _mm_set1_ps(ascender * scale));
+      auto right    = _mm_add_ps(left, _mm_mul_ps(_mm_setr_ps(infos[0]->extent.x, infos[1]->extent.x, infos[2]->extent.x, infos[3]->extent.x), s));
+      auto bottom   = _mm_add_ps(top,  _mm_mul_ps(_mm_setr_ps(infos[0]->extent.y, infos[1]->extent.y, infos[2]->extent.y, infos[3]->extent.y), s));
+      // every row is (left, top, right, bottom) of a glyph
+      _MM_TRANSPOSE4_PS(left, top, right, bottom);
+      infos[0]->store_quad(out,      left,   offset);
+      infos[1]->store_quad(out + 4,  top,    offset);
+      infos[2]->store_quad(out + 8,  right,  offset);
+      infos[3]->store_quad(out + 12, bottom, offset);
+#else
+      for (uint32_t i = 0; i < 4; ++i)
+        infos[i]->write_vertices_scalar(out + i * 4, pos[i], scale, offset, ascender);
+#endif
+    }
+
+    void write_vertices_scalar(Vertex* out, glm::vec2 const& pos, float scale, uint32_t offset, float ascender) const noexcept
     {
-      // TODO: add vertical draw in future
-      auto scale = get_scale(size);
       auto p0 = pos + pos_offset * scale;
       p0.y += ascender * scale;
       auto p1 = glm::vec2{ p0.x + extent.x * scale, p0.y };
       auto p2 = glm::vec2{ p0.x, p0.y + extent.y * scale };
-      auto p3 = glm::vec2{ p1.x, p2.y };      
-      return
-      {
-        { p0, { min_x, min_y }, offset, glyph_atlases_index },
-        { p1, { max_x, min_y }, offset, glyph_atlases_index },
-        { p2, { min_x, max_y }, offset, glyph_atlases_index },
-        { p3, { max_x, max_y }, offset, glyph_atlases_index },
-      };
+      auto p3 = glm::vec2{ p1.x, p2.y };
+      out[0] = { p0, { min_x, min_y }, offset, glyph_atlas_index };
+      out[1] = { p1, { max_x, min_y }, offset, glyph_atlas_index };
+      out[2] = { p2, { min_x, max_y }, offset, glyph_atlas_index };
+      out[3] = { p3, { max_x, max_y }, offset, glyph_atlas_index };
+    }
+
+#ifdef TK_SSE2
+    void write_vertices_sse2(Vertex* out, glm::vec2 const& pos, float scale, uint32_t offset, float ascender) const noexcept
+    {
+      // same operations and order as scalar path, so results are bit identical
+      auto s        = _mm_set1_ps(scale);
+      auto fields   = _mm_loadu_ps(&extent.x);  // (extent, pos_offset)
+      auto p0       = _mm_add_ps(_mm_setr_ps(pos.x, pos.y, 0.f, 0.f), _mm_mul_ps(_mm_movehl_ps(fields, fields), s));
+      // ascender is only added to y, x keeps its value even if it is negative zero
+      p0            = _mm_move_ss(_mm_add_ps(p0, _mm_set1_ps(ascender * scale)), p0);
+      auto p3       = _mm_add_ps(p0, _mm_mul_ps(fields, s));
+      store_quad(out, _mm_movelh_ps(p0, p3), offset);
+    }
+
+    // write 4 vertices, lanes of corners are (left, top, right, bottom)
+    void store_quad(Vertex* out, __m128 corners, uint32_t offset) const noexcept
+    {
+      auto p   = corners;
+      auto uv  = _mm_loadu_ps(&min_x);  // (min_x, min_y, max_x, max_y)
+      auto ids = _mm_setr_epi32(static_cast<int>(offset), static_cast<int>(glyph_atlas_index), 0, 0);
+
+      _mm_storeu_ps(&out[0].pos.x, _mm_movelh_ps(p, uv));
+      _mm_storeu_ps(&out[1].pos.x, _mm_movelh_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 2)), _mm_shuffle_ps(uv, uv, _MM_SHUFFLE(3, 3, 1, 2))));
+      _mm_storeu_ps(&out[2].pos.x, _mm_movelh_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 0)), _mm_shuffle_ps(uv, uv, _MM_SHUFFLE(3, 3, 3, 0))));
+      _mm_storeu_ps(&out[3].pos.x, _mm_movehl_ps(uv, p));
+      for (uint32_t i = 0; i < 4; ++i)
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[i].offset), ids);
     }
+#endif
 
-    static auto get_indices(uint16_t& index) noexcept -> std::vector<uint16_t>
+    /**
+     * write 6 indices of every quad
+     * @param out
+     * @param count count of quads
+     * @param index first vertex index of quads, advanced after them
+     */
+    static void write_indices(uint16_t* out, uint32_t count, uint16_t& index) noexcept
     {
-      auto idx = index;
-      index += 4;
-      return
+      uint32_t i{};
+#ifdef TK_SSE2
+      // indices of 4 quads fill 3 registers
+      alignas(16) static constexpr uint16_t pattern[24]
       {
-        static_cast<uint16_t>(idx + 0), static_cast<uint16_t>(idx + 1), static_cast<uint16_t>(idx + 2),
-        static_cast<uint16_t>(idx + 2), static_cast<uint16_t>(idx + 1), static_cast<uint16_t>(idx + 3),
+        0, 1, 2,  2,  1, 3,  4,  5,  6,  6,  5,  7,
+        8, 9, 10, 10, 9, 11, 12, 13, 14, 14, 13, 15,
       };
+      for (; i + 4 <= count; i += 4, index += 16)
+      {
+        auto base = _mm_set1_epi16(static_cast<short>(index));
+        for (uint32_t j = 0; j < 3; ++j)
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 6 + j * 8),
+                           _mm_add_epi16(_mm_load_si128(reinterpret_cast<__m128i const*>(pattern) + j), base));
+      }
+#endif
+      for (; i < count; ++i, index += 4)
+      {
+        auto quad = out + i * 6;
+        quad[0] = static_cast<uint16_t>(index + 0);
+        quad[1] = static_cast<uint16_t>(index + 1);
+        quad[2] = static_cast<uint16_t>(index + 2);
+        quad[3] = static_cast<uint16_t>(index + 2);
+        quad[4] = static_cast<uint16_t>(index + 1);
+        quad[5] = static_cast<uint16_t>(index + 3);
+      }
     }
 
     static auto get_next_position(glm::vec2 const& pos, float size, glm::vec2 const& advance) noexcept
@@ -218,4 +596,40 @@ namespace tk { namespace graphics_engine {
       return pos + advance * get_scale(size);
     }
   };
+
+  // single entry answers whether glyph of font is cached or wait to generate in every tier
+  struct GlyphEntry
+  {
+    enum class State : uint8_t
+    {
+      unknown,
+      preload,       // queued by preloading, moved to wait_generate when drawn
+      prepare,       // generating on preparation thread
+      wait_generate,
+      cached,
+    };
+
+    Font*                                         font{};        // nullptr for builtin glyph
+    uint32_t                                      glyph_index{};
+    uint32_t                                      min_tier{};
+    bool                                          msdf{};
+    bool                                          color{};
+    uint32_t                                      color_cell{};  // valid when cached
+    std::array<State, TextEngine::Tier_Count>     states{};
+    std::array<GlyphInfo, TextEngine::Tier_Count> infos{};       // valid when cached
+
+    // msdf can be magnified twice as much as sdf, so uses one smaller tier
+    // colour glyph only has bitmap of colour tier
+    auto get_tier(uint32_t size_tier) const noexcept
+    {
+      if (color) return TextEngine::Color_Glyph_Tier;
+      return std::max(min_tier, msdf && size_tier > 0 ? size_tier - 1 : size_tier);
+    }
+  };
+
+  // simd writing of quads loads fields as vectors
+  static_assert(offsetof(GlyphInfo, max_y)      == offsetof(GlyphInfo, min_x)  + 3 * sizeof(float));
+  static_assert(offsetof(GlyphInfo, pos_offset) == offsetof(GlyphInfo, extent) + 2 * sizeof(float));
+  static_assert(offsetof(Vertex, uv)                  == offsetof(Vertex, pos) + 2 * sizeof(float));
+  static_assert(offsetof(Vertex, glyph_atlases_index) == offsetof(Vertex, offset) + sizeof(uint32_t));
 }}
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "TextLayout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+
+namespace tk { namespace graphics_engine {
+
+////////////////////////////////////////////////////////////////////////////////
+///                           Line Break Class
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// subset of UAX #14 line break classes,
+// classes before ZW are used by pair table, others are handled specially
+enum class LineBreakClass : uint8_t
+{
+  OP, // open punctuation
+  CL, // close punctuation
+  QU, // quotation
+  GL, // non-breaking glue
+  NS, // nonstarter (small kana, prolonged sound mark...)
+  EX, // exclamation and interrogation
+  IS, // infix numeric separator
+  NU, // numeric
+  AL, // alphabetic
+  ID, // ideographic
+  HY, // hyphen
+  BA, // break after
+
+  ZW, // zero width space
+  CM, // combining mark
+  SP, // space
+  BK, // mandatory break
+};
+
+constexpr auto Pair_Table_Size = static_cast<uint32_t>(LineBreakClass::ZW);
+
+// _: direct break, %: indirect break (only when spaces between), ^: prohibited break
+enum class PairAction : uint8_t
+{
+  direct,
+  indirect,
+  prohibited,
+};
+
+constexpr auto make_pair_table()
+{
+  constexpr char const* rows[Pair_Table_Size]
+  {
+    // OP CL QU GL NS EX IS NU AL ID HY BA
+    "^^^^^^^^^^^^", // OP
+    "_^%%^^^___%%", // CL
+    "^^%%%^^%%%%%", // QU
+    "%^%%%^^%%%%%", // GL
+    "_^%%%^^___%%", // NS
+    "_^%%%^^___%%", // EX
+    "_^%%%^^%%_%%", // IS
+    "%^%%%^^%%_%%", // NU
+    "%^%%%^^%%_%%", // AL
+    "_^%%%^^___%%", // ID
+    "_^%_%^^%__%%", // HY
+    "_^%_%^^___%%", // BA
+  };
+  std::array<std::array<PairAction, Pair_Table_Size>, Pair_Table_Size> table{};
+  for (uint32_t i = 0; i < Pair_Table_Size; ++i)
+    for (uint32_t j = 0; j < Pair_Table_Size; ++j)
+      table[i][j] = rows[i][j] == '_' ? PairAction::direct   :
+                    rows[i][j] == '%' ? PairAction::indirect :
+                                        PairAction::prohibited;
+  return table;
+}
+constexpr auto Pair_Table = make_pair_table();
+
+constexpr auto in(char32_t ch, char32_t begin, char32_t end) noexcept
+{
+  return ch >= begin && ch <= end;
+}
+
+auto get_line_break_class(char32_t ch) noexcept -> LineBreakClass
+{
+  using enum LineBreakClass;
+
+  switch (ch)
+  {
+  case U'\n': case U'\v': case U'\f': case U'\r':
+  case 0x0085: case 0x2028: case 0x2029:
+    return BK;
+
+  case U' ':
+    return SP;
+
+  case 0x200b:
+    return ZW;
+
+  case 0x00a0: case 0x2007: case 0x202f: case 0x2060: case 0xfeff:
+    return GL;
+
+  case U'(': case U'[': case U'{':
+  case 0x3008: case 0x300a: case 0x300c: case 0x300e: case 0x3010: // 〈《「『【
+  case 0x3014: case 0x3016: case 0x3018: case 0x301a: case 0x301d: // 〔〖〘〚〝
+  case 0xff08: case 0xff3b: case 0xff5b: case 0xff5f: case 0xff62: // （［｛｟｢
+    return OP;
+
+  case U')': case U']': case U'}':
+  case 0x3001: case 0x3002:                                        // 、。
+  case 0x3009: case 0x300b: case 0x300d: case 0x300f: case 0x3011: // 〉》」』】
+  case 0x3015: case 0x3017: case 0x3019: case 0x301b: case 0x301e: // 〕〗〙〛〞
+  case 0x301f:                                                     // 〟
+  case 0xff09: case 0xff0c: case 0xff0e: case 0xff3d: case 0xff5d: // ），．］｝
+  case 0xff60: case 0xff61: case 0xff63: case 0xff64:              // ｠｡｣､
+    return CL;
+
+  case U'"': case U'\'': case 0x00ab: case 0x00bb:
+    return QU;
+
+  case U'!': case U'?': case 0xff01: case 0xff1f:
+    return EX;
+
+  case U',': case U'.': case U':': case U';': case U'/': case 0x037e:
+    return IS;
+
+  case U'-':
+    return HY;
+
+  case U'\t': case 0x00ad: case 0x2010: case 0x2012: case 0x2013:
+  case 0x2027: case 0x3000:
+    return BA;
+
+  // small kana, iteration marks, prolonged sound marks and other japanese kinsoku characters
+  case 0x3041: case 0x3043: case 0x3045: case 0x3047: case 0x3049: // ぁぃぅぇぉ
+  case 0x3063: case 0x3083: case 0x3085: case 0x3087: case 0x308e: // っゃゅょゎ
+  case 0x3095: case 0x3096:                                        // ゕゖ
+  case 0x30a1: case 0x30a3: case 0x30a5: case 0x30a7: case 0x30a9: // ァィゥェォ
+  case 0x30c3: case 0x30e3: case 0x30e5: case 0x30e7: case 0x30ee: // ッャュョヮ
+  case 0x30f5: case 0x30f6:                                        // ヵヶ
+  case 0x3005: case 0x303b: case 0x309d: case 0x309e: case 0x30a0: // 々〻ゝゞ゠
+  case 0x30fb: case 0x30fc: case 0x30fd: case 0x30fe:              // ・ーヽヾ
+  case 0x2025: case 0x2026: case 0xff1a: case 0xff1b: case 0xff70: // ‥…：；ｰ
+    return NS;
+  }
+
+  if (in(ch, U'0', U'9'))
+    return NU;
+
+  if (in(ch, 0x0300, 0x036f) || in(ch, 0x3099, 0x309a) || in(ch, 0xfe00, 0xfe0f) ||
+      in(ch, 0x200c, 0x200d) || in(ch, 0xe0100, 0xe01ef))
+    return CM;
+
+  if (in(ch, 0x2018, 0x201f))
+    return QU;
+
+  if (in(ch, 0xff67, 0xff6f) || in(ch, 0x31f0, 0x31ff))
+    return NS;
+
+  if (in(ch, 0x2e80, 0x2fff)   || // cjk radicals
+      in(ch, 0x3003, 0x303f)   || // cjk symbols
+      in(ch, 0x3040, 0x30ff)   || // hiragana, katakana
+      in(ch, 0x3100, 0x4dbf)   || // bopomofo, cjk strokes, enclosed, cjk extension a
+      in(ch, 0x4e00, 0x9fff)   || // cjk unified ideographs
+      in(ch, 0xa000, 0xa4cf)   || // yi
+      in(ch, 0xac00, 0xd7a3)   || // hangul syllables
+      in(ch, 0xf900, 0xfaff)   || // cjk compatibility ideographs
+      in(ch, 0xfe30, 0xfe4f)   || // cjk compatibility forms
+      in(ch, 0xff00, 0xffef)   || // fullwidth forms
+      in(ch, 0x1f000, 0x1faff) || // emoji and pictographs
+      in(ch, 0x20000, 0x3fffd))   // cjk extension b and later
+    return ID;
+
+  return AL;
+}
+
+}
+
+void get_line_breaks(std::u32string_view text, std::span<LineBreak> breaks)
+{
+  using enum LineBreakClass;
+
+  assert(breaks.size() == text.size() + 1);
+  std::ranges::fill(breaks, LineBreak::none);
+  if (text.empty()) return;
+
+  // never break at start of text
+  auto prev = get_line_break_class(text[0]);
+  if (prev == SP || prev == CM) prev = AL;
+
+  for (uint32_t i = 1; i < text.size(); ++i)
+  {
+    auto cur = get_line_break_class(text[i]);
+
+    // break after mandatory break, but CR LF as single one
+    if (prev == BK)
+    {
+      if (text[i - 1] == U'\r' && text[i] == U'\n') continue;
+      breaks[i] = LineBreak::mandatory;
+      prev = cur == SP || cur == CM ? AL : cur;
+      continue;
+    }
+
+    // never break before space and mandatory break
+    if (cur == SP) continue;
+    if (cur == BK)
+    {
+      prev = BK;
+      continue;
+    }
+
+    // break after zero width space
+    if (cur == ZW)
+    {
+      prev = ZW;
+      continue;
+    }
+    if (prev == ZW)
+    {
+      breaks[i] = LineBreak::allowed;
+      prev = cur == CM ? AL : cur;
+      continue;
+    }
+
+    // combining mark attachs to previous character
+    if (cur == CM) continue;
+
+    auto action = Pair_Table[static_cast<uint32_t>(prev)][static_cast<uint32_t>(cur)];
+    if (action == PairAction::direct ||
+        (action == PairAction::indirect && get_line_break_class(text[i - 1]) == SP))
+      breaks[i] = LineBreak::allowed;
+
+    prev = cur;
+  }
+
+  // text end with mandatory break, next appended text should start at new line
+  if (prev == BK)
+    breaks[text.size()] = LineBreak::mandatory;
+}
+
+auto is_line_end_trimmed(char32_t ch) noexcept -> bool
+{
+  auto cls = get_line_break_class(ch);
+  return cls == LineBreakClass::SP || cls == LineBreakClass::BK || ch == U'\t';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///                                 Ruby
+////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+auto is_kanji(char32_t ch) noexcept
+{
+  return in(ch, 0x4e00, 0x9fff)   || // cjk unified ideographs
+         in(ch, 0x3400, 0x4dbf)   || // cjk extension a
+         in(ch, 0xf900, 0xfaff)   || // cjk compatibility ideographs
+         in(ch, 0x20000, 0x3fffd) || // cjk extension b and later
+         ch == 0x3005 || ch == 0x3006 || ch == 0x3007 || ch == 0x30f6; // 々〆〇ヶ
+}
+
+}
+
+auto parse_ruby_notation(std::u32string_view text, std::vector<RubyNotation>& notations) -> std::u32string
+{
+  constexpr auto no_marker = std::numeric_limits<uint32_t>::max();
+
+  std::u32string result;
+  result.reserve(text.size());
+  auto marker = no_marker;
+  for (uint32_t i = 0; i < text.size(); ++i)
+  {
+    // ｜ marks begin of base
+    if (text[i] == 0xff5c)
+    {
+      marker = static_cast<uint32_t>(result.size());
+      continue;
+    }
+
+    // 《ruby》 after base, otherwise they are normal characters
+    if (text[i] == 0x300a)
+    {
+      auto close = text.find(0x300b, i + 1);
+      auto end   = static_cast<uint32_t>(result.size());
+      auto begin = marker;
+      if (begin == no_marker)
+        for (begin = end; begin > 0 && is_kanji(result[begin - 1]); --begin);
+      if (close != std::u32string_view::npos && close > i + 1 && begin < end)
+      {
+        notations.emplace_back(RubyNotation{ begin, end, text.substr(i + 1, close - i - 1) });
+        marker = no_marker;
+        i      = static_cast<uint32_t>(close);
+        continue;
+      }
+    }
+
+    result += text[i];
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///                              Paragraph
+////////////////////////////////////////////////////////////////////////////////
+
+void Paragraph::layout(uint32_t first_line)
+{
+  assert(text.size() == advances.size());
+
+  assert(first_line == 0 || first_line < lines.size());
+
+  auto size  = static_cast<uint32_t>(text.size());
+  auto begin = first_line < lines.size() ? lines[first_line].begin : 0;
+  lines.resize(first_line);
+
+  // only break opportunities from begin of first changed line need to be updated
+  breaks.resize(size + 1);
+  get_line_breaks(std::u32string_view{ text }.substr(begin), std::span{ breaks }.subspan(begin));
+
+  // ruby base is kept in one line
+  for (auto const& ruby : rubies)
+    for (auto i = std::max(ruby.begin + 1, begin); i < ruby.end; ++i)
+      breaks[i] = LineBreak::none;
+
+  auto add_line = [&](uint32_t line_begin, uint32_t line_end)
+  {
+    // trailing spaces and new lines are not visible
+    while (line_end > line_begin && is_line_end_trimmed(text[line_end - 1]))
+      --line_end;
+    auto& line = lines.emplace_back(TextLine{ line_begin, line_end });
+    for (auto i = line_begin; i < line_end; ++i)
+      line.width += get_advance(i);
+  };
+
+  while (begin < size)
+  {
+    auto  end        = begin;
+    auto  last_break = begin;
+    float width      = {};
+    bool  overflow   = {};
+
+    for (; end < size; ++end)
+    {
+      if (end > begin)
+      {
+        if (breaks[end] == LineBreak::mandatory) break;
+        if (breaks[end] == LineBreak::allowed)   last_break = end;
+      }
+
+      // trailing spaces can hang out of box
+      if (is_line_end_trimmed(text[end]))
+      {
+        width += get_advance(end);
+        continue;
+      }
+
+      // at least one character for every line
+      if (end > begin && width + get_advance(end) > max_width)
+      {
+        overflow = true;
+        break;
+      }
+      width += get_advance(end);
+    }
+
+    // break at last opportunity, if not have, force break at current character
+    if (overflow && last_break > begin)
+      end = last_break;
+
+    add_line(begin, end);
+    begin = end;
+  }
+
+  // empty line for mandatory break at end of text
+  if (breaks[size] == LineBreak::mandatory && (lines.empty() || lines.back().begin != size))
+    lines.emplace_back(TextLine{ size, size });
+}
+
+void Paragraph::update_advances(uint32_t first_glyph)
+{
+  assert(first_glyph <= glyphs.size());
+  // right to left runs decrease clusters
+  assert(std::ranges::is_sorted(glyphs.begin() + first_glyph, glyphs.end(), {}, &ShapedGlyph::cluster));
+
+  auto begin = first_glyph < glyphs.size() ? glyphs[first_glyph].cluster : static_cast<uint32_t>(text.size());
+  advances.resize(begin);
+  advances.resize(text.size());
+  for (auto i = first_glyph; i < glyphs.size(); ++i)
+    advances[glyphs[i].cluster] += glyphs[i].advance;
+}
+
+auto Paragraph::width() const noexcept -> float
+{
+  float width{};
+  for (auto const& line : lines)
+    width = std::max(width, line.width);
+  return width;
+}
+
+}}
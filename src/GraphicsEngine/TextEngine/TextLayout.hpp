@@ -0,0 +1,177 @@
+//
+// text layout
+//
+// paragraph layout with line breaking in a box width.
+// line break opportunities use pair table of UAX #14 with a subset of classes,
+// which covers latin words, cjk ideographs and japanese kinsoku characters.
+//
+// paragraph keeps shaped glyphs, break opportunities and lines together,
+// so appending characters only re-shape and re-break from the last line,
+// lines before it will not be touched.
+//
+// vertical paragraph uses same line breaking, lines are columns and their width is along y axis.
+// clusters of glyphs should increase, such as left to right and vertical text,
+// visible characters and lines are found by them. right to left runs are not supported in paragraph.
+//
+// ruby (furigana) is written in notation of aozora bunko, ｜base《ruby》 or kanji《ruby》.
+// base is never broken between lines, and is spread when its ruby is wider.
+//
+
+#pragma once
+
+#include "tk/type.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+
+namespace tk { namespace graphics_engine {
+
+  enum class LineBreak : uint8_t
+  {
+    none,
+    allowed,
+    mandatory,
+  };
+
+  /**
+   * get break opportunity before every character
+   * @param text
+   * @param breaks size should be text size + 1, last one is break after text
+   */
+  void get_line_breaks(std::u32string_view text, std::span<LineBreak> breaks);
+
+  // line is never break after this character, such as new line and space
+  auto is_line_end_trimmed(char32_t ch) noexcept -> bool;
+
+  // glyph of shaping result, in pixel size of font
+  struct ShapedGlyph
+  {
+    uint32_t  entry_index{}; // entry of (font, glyph id) in glyph table
+    uint32_t  cluster{};     // index of first character of cluster in text
+    glm::vec2 advance{};
+    glm::vec2 offset{};
+  };
+
+  struct RubyNotation
+  {
+    uint32_t            begin{}; // range of base in text without notations
+    uint32_t            end{};
+    std::u32string_view ruby;
+  };
+
+  /**
+   * parse ruby notations of aozora bunko
+   * base begins from ｜, or is kanji run before 《 if no ｜
+   * @param text
+   * @param notations parsed rubies are appended to it
+   * @return text without notations
+   */
+  auto parse_ruby_notation(std::u32string_view text, std::vector<RubyNotation>& notations) -> std::u32string;
+
+  struct Ruby
+  {
+    // ruby is half size of base text
+    static constexpr float Ruby_Scale = .5f;
+
+    uint32_t                 begin{};  // range of base characters
+    uint32_t                 end{};
+    std::vector<ShapedGlyph> glyphs;          // in pixel size of font, not scaled
+    float                    width{};         // scaled width
+    float                    max_ascender{};  // of fonts of ruby, not scaled
+  };
+
+  struct TextLine
+  {
+    uint32_t begin{}; // first character
+    uint32_t end{};   // after last visible character
+    float    width{};
+  };
+
+  // all lengths are in pixel size of font
+  struct Paragraph
+  {
+    type::TextDirection      direction{};
+    std::u32string           text;
+    std::vector<ShapedGlyph> glyphs;
+    std::vector<glm::vec2>   advances; // advance of every character, sum of its cluster's glyphs on first character
+    std::vector<LineBreak>   breaks;
+    std::vector<TextLine>    lines;
+    std::vector<Ruby>        rubies;   // sorted by base
+    float                    max_width{};
+    float                    max_ascender{};
+    float                    max_height{};
+    bool                     has_missing_glyphs{};
+    uint64_t                 last_used{};  // frame count of text engine, paragraph not used for long is evicted
+    bool                     prepared{};   // prepared and not drawn yet
+
+    /**
+     * break lines from specific line, lines before it are kept
+     * @param first_line index of first line need to re-break
+     */
+    void layout(uint32_t first_line = 0);
+
+    // advance of character along line
+    auto get_advance(uint32_t index) const noexcept
+    {
+      return direction == type::TextDirection::vertical ? advances[index].y : advances[index].x;
+    }
+
+    // begin character of last line, appended text should be re-shaped from here
+    auto last_line_begin() const noexcept -> uint32_t
+    {
+      return lines.empty() ? 0 : lines.back().begin;
+    }
+
+    auto width() const noexcept -> float;
+
+    // accumulate advances of glyphs from specific one to their characters
+    void update_advances(uint32_t first_glyph = 0);
+  };
+
+  struct ParagraphKeyView
+  {
+    std::string_view    text;
+    float               max_width{};
+    type::FontStyle     style{};
+    type::TextDirection direction{};
+  };
+
+  struct ParagraphKey
+  {
+    std::string         text;
+    float               max_width{};
+    type::FontStyle     style{};
+    type::TextDirection direction{};
+
+    operator ParagraphKeyView() const noexcept { return { text, max_width, style, direction }; }
+  };
+
+  struct ParagraphKeyHash
+  {
+    using is_transparent = void;
+
+    auto operator()(ParagraphKeyView const& key) const noexcept -> size_t
+    {
+      auto hash = std::hash<std::string_view>{}(key.text);
+      hash ^= std::hash<float>{}(key.max_width) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= static_cast<size_t>(key.style)     + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= static_cast<size_t>(key.direction) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      return hash;
+    }
+  };
+
+  struct ParagraphKeyEqual
+  {
+    using is_transparent = void;
+
+    auto operator()(ParagraphKeyView const& a, ParagraphKeyView const& b) const noexcept -> bool
+    {
+      return a.max_width == b.max_width && a.style == b.style && a.direction == b.direction && a.text == b.text;
+    }
+  };
+
+}}
@@ -0,0 +1,125 @@
+#include "TransferQueue.hpp"
+#include "../ErrorHandling.hpp"
+
+#include <cassert>
+
+namespace tk { namespace graphics_engine {
+
+void TransferQueue::init(VkDevice device, uint32_t queue_family, VkQueue queue)
+{
+  _device = device;
+  _family = queue_family;
+  _queue  = queue;
+  _command_pool.init(device, queue_family);
+
+  auto type_info = VkSemaphoreTypeCreateInfo
+  {
+    .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+    .initialValue  = 0,
+  };
+  auto sem_create_info = VkSemaphoreCreateInfo
+  {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    .pNext = &type_info,
+  };
+  throw_if(vkCreateSemaphore(device, &sem_create_info, nullptr, &_semaphore) != VK_SUCCESS,
+           "failed to create timeline semaphore of transfer queue");
+}
+
+void TransferQueue::destroy()
+{
+  if (!valid()) return;
+
+  vkQueueWaitIdle(_queue);
+  for (auto& destructor : _destructors)
+    destructor.func();
+  _destructors.clear();
+  _pending_destruction_bytes = {};
+  _submits.clear();
+  _free_commands.clear();
+  vkDestroySemaphore(_device, _semaphore, nullptr);
+  _command_pool.destroy();
+  _queue = VK_NULL_HANDLE;
+}
+
+auto TransferQueue::get_command() -> Command const&
+{
+  assert(valid());
+  if (_recording) return _command;
+
+  collect();
+  if (_free_commands.empty())
+    _command = _command_pool.create_command();
+  else
+  {
+    _command = _free_commands.back();
+    _free_commands.pop_back();
+  }
+  throw_if(vkResetCommandBuffer(_command, 0) != VK_SUCCESS,
+           "failed to reset command buffer");
+  _command.begin();
+  _recording = true;
+  return _command;
+}
+
+auto TransferQueue::submit() -> uint64_t
+{
+  if (!_recording) return _value;
+  _command.end();
+  _recording = false;
+
+  VkCommandBufferSubmitInfo cmd_submit_info
+  {
+    .sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+    .commandBuffer = _command,
+  };
+  VkSemaphoreSubmitInfo signal_sem_submit_info
+  {
+    .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+    .semaphore = _semaphore,
+    .value     = _value + 1,
+    .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+  };
+  VkSubmitInfo2 submit_info
+  {
+    .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+    .commandBufferInfoCount   = 1,
+    .pCommandBufferInfos      = &cmd_submit_info,
+    .signalSemaphoreInfoCount = 1,
+    .pSignalSemaphoreInfos    = &signal_sem_submit_info,
+  };
+  throw_if(vkQueueSubmit2(_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS,
+           "failed to submit to transfer queue");
+
+  _submits.emplace_back(_command, ++_value);
+  return _value;
+}
+
+void TransferQueue::retire(InplaceFunction<void()>&& func, VkDeviceSize bytes)
+{
+  // recording uploads are submitted later, also wait them
+  _destructors.emplace_back(Destructor{ _value + (_recording ? 1 : 0), std::move(func), bytes });
+  _pending_destruction_bytes += bytes;
+}
+
+void TransferQueue::collect()
+{
+  uint64_t finished_value;
+  throw_if(vkGetSemaphoreCounterValue(_device, _semaphore, &finished_value) != VK_SUCCESS,
+           "failed to get value of timeline semaphore");
+
+  while (!_submits.empty() && _submits.front().value <= finished_value)
+  {
+    _free_commands.emplace_back(_submits.front().cmd);
+    _submits.pop_front();
+  }
+  while (!_destructors.empty() && _destructors.front().value <= finished_value)
+  {
+    _destructors.front().func();
+    _pending_destruction_bytes -= _destructors.front().bytes;
+    _destructors.pop_front();
+  }
+}
+
+}}
@@ -0,0 +1,89 @@
+//
+// transfer queue
+//
+// uploads on dedicated transfer queue run asynchronously with rendering.
+// every submit signals a bigger value of timeline semaphore,
+// graphics queue only waits value of uploads to resources it samples.
+// it is invalid on devices without dedicated transfer queue, such as lavapipe,
+// then uploads are recorded in graphics command.
+//
+
+#pragma once
+
+#include "CommandPool.hpp"
+#include "../InplaceFunction.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <vector>
+
+namespace tk { namespace graphics_engine {
+
+  class TransferQueue
+  {
+  public:
+    TransferQueue()                                = default;
+    TransferQueue(TransferQueue const&)            = delete;
+    TransferQueue(TransferQueue&&)                 = delete;
+    TransferQueue& operator=(TransferQueue const&) = delete;
+    TransferQueue& operator=(TransferQueue&&)      = delete;
+
+    void init(VkDevice device, uint32_t queue_family, VkQueue queue);
+    void destroy();
+
+    auto valid()     const noexcept { return _queue != VK_NULL_HANDLE; }
+    auto family()    const noexcept { return _family;                  }
+    auto semaphore() const noexcept { return _semaphore;               }
+
+    // command to record uploads, begun already
+    auto get_command() -> Command const&;
+
+    /**
+     * submit recorded command
+     * @return value of timeline semaphore signaled when uploads finished
+     */
+    auto submit() -> uint64_t;
+
+    /**
+     * destroy after last submitted uploads finished, such as staging buffers
+     * @param func
+     * @param bytes memory released by func, counted as pending destruction
+     */
+    void retire(InplaceFunction<void()>&& func, VkDeviceSize bytes = 0);
+
+    // old resources waiting uploads finished, graphics frames count their own
+    auto get_pending_destruction_count() const noexcept { return static_cast<uint32_t>(_destructors.size()); }
+    auto get_pending_destruction_bytes() const noexcept { return _pending_destruction_bytes; }
+
+    // recycle commands and destroy resources of finished uploads
+    void collect();
+
+  private:
+    struct Submit
+    {
+      Command  cmd;
+      uint64_t value{};
+    };
+
+    VkDevice                 _device{};
+    VkQueue                  _queue{};
+    uint32_t                 _family{};
+    CommandPool              _command_pool;
+    VkSemaphore              _semaphore{};
+    uint64_t                 _value{};          // value of last submit
+    Command                  _command;          // recording command
+    bool                     _recording{};
+    std::deque<Submit>       _submits;
+    std::vector<Command>     _free_commands;
+    struct Destructor
+    {
+      uint64_t                value{};
+      InplaceFunction<void()> func;
+      VkDeviceSize            bytes{};
+    };
+    std::deque<Destructor>   _destructors;
+    VkDeviceSize             _pending_destruction_bytes{};
+  };
+
+}}
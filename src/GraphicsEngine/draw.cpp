@@ -3,14 +3,50 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
 
 namespace tk { namespace graphics_engine {
 
-auto GraphicsEngine::frame_begin() -> bool
+namespace
+{
+
+// rubies are on top of each line, their height is added to line
+auto get_ruby_height(Paragraph const& paragraph, float scale) noexcept
+{
+  return paragraph.rubies.empty() ? 0.f : paragraph.max_height * scale * Ruby::Ruby_Scale;
+}
+
+auto get_line_advance(Paragraph const& paragraph, float scale, float line_height) noexcept
+{
+  return paragraph.max_height * line_height * scale + get_ruby_height(paragraph, scale);
+}
+
+// extent of single line text is advance of pen, parse and measure give same result
+auto get_text_extent(ShapedText const& shaped_text, float scale) noexcept
+{
+  auto width = 0.f;
+  for (auto const& glyph : shaped_text.glyphs)
+    width += glyph.advance.x;
+  return glm::vec2{ width, shaped_text.max_height } * scale;
+}
+
+auto get_paragraph_extent(Paragraph const& paragraph, float scale, float line_height) noexcept
+{
+  auto lines_extent = paragraph.lines.size() * get_line_advance(paragraph, scale, line_height);
+  if (paragraph.direction == type::TextDirection::vertical)
+    return glm::vec2{ lines_extent, paragraph.width() * scale };
+  return glm::vec2{ paragraph.width() * scale, lines_extent };
+}
+
+}
+
+auto GraphicsEngine::frame_begin() -> AcquireResult
 {
-  // acquire new frame's swapchain image
-  if (_frames.acquire_swapchain_image(_wait_fence) == false)
-    return false;
+  // acquire new frame's swapchain image,
+  // skip frame if gpu is busy when not wait, or swapchain is out of date until window resizes it
+  if (auto result = _frames.acquire_swapchain_image(_wait_frame); result != AcquireResult::success)
+    return result;
 
   // get current frame's command
   auto& cmd = _frames.get_command();
@@ -18,14 +54,16 @@ auto GraphicsEngine::frame_begin() -> bool
   // destroy old resources
   _frames.destroy_old_resources();
 
+  check_memory_budget();
+
   // set resources for a new frame
-  _sdf_buffer.frame_begin();
-  if (_text_engine.frame_begin(cmd))
+  _frame_buffer.release();
+  if (_text_engine.frame_begin(cmd, _frames.get_barriers()))
   {
     // TODO: can optimal use bigger descriptor pool and layout, then only update new descriptors?
     //       only recreate descriptor pool until pool is unenough
     // destroy old graphics pipeline
-    _frames.push_old_resource([pipeline = this->_sdf_graphics_pipeline] { pipeline.destroy_without_shader_modules(); });  
+    _frames.push_old_resource(_sdf_graphics_pipeline.get_destroyer_without_shader_modules());
     // create new one
     _sdf_graphics_pipeline.recreate(
     {
@@ -33,20 +71,55 @@ auto GraphicsEngine::frame_begin() -> bool
     });
   }
 
-  return true;
+  return AcquireResult::success;
+}
+
+auto GraphicsEngine::get_memory_stats() const -> type::MemoryStats
+{
+  auto stats = _mem_alloc.get_memory_stats();
+  // swapchain images are owned by presentation engine, estimate them by 4 bytes per texel
+  auto& render_target  = stats.categories[static_cast<uint32_t>(type::MemoryCategory::render_target)];
+  auto  extent         = _swapchain.extent();
+  render_target.allocation_count += _swapchain.size();
+  render_target.bytes            += static_cast<uint64_t>(extent.width) * extent.height * 4 * _swapchain.size();
+  if (_memory_budget) stats.budget = _memory_budget;
+  // old resources of graphics frames and of uploads on transfer queue
+  stats.pending_destruction_count = _frames.get_pending_destruction_count() + _transfer_queue.get_pending_destruction_count();
+  stats.pending_destruction_bytes = _frames.get_pending_destruction_bytes() + _transfer_queue.get_pending_destruction_bytes();
+  return stats;
+}
+
+void GraphicsEngine::check_memory_budget()
+{
+  if (!_memory_budget_callback) return;
+
+  auto [usage, budget] = _mem_alloc.get_memory_usage_and_budget();
+  if (_memory_budget) budget = _memory_budget;
+  if (usage <= budget)
+  {
+    _over_memory_budget = false;
+    return;
+  }
+  // only notify once until usage drops under budget
+  if (_over_memory_budget) return;
+  _over_memory_budget = true;
+  _memory_budget_callback(get_memory_stats());
 }
 
 void GraphicsEngine::frame_end()
 {
-  //_frames.copy_image_to_swapchain(_offscreen_image);
-  _frames.present_swapchain_image(_graphics_queue, _present_queue);
+  _frame_buffer.frame_end();
+  _frames.present_swapchain_image(_graphics_queue, _present_queue,
+                                  _transfer_queue.semaphore(), _text_engine.take_sampled_upload_value());
 }
 
 void GraphicsEngine::render_begin(Image& image)
 {
   auto& cmd = _frames.get_command();
 
-  image.set_layout(cmd, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  // pending barriers such as glyph atlases uploaded are recorded together
+  _frames.get_barriers().add(image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                        .flush(cmd);
   
   auto color_attachment = VkRenderingAttachmentInfo
   {
@@ -78,54 +151,39 @@ void GraphicsEngine::render_end()
   vkCmdEndRendering(_frames.get_command());
 }
 
-void GraphicsEngine::sdf_render(std::span<Vertex> vertices, std::span<uint16_t> indices, std::span<ShapeProperty> shape_properties)
+void GraphicsEngine::sdf_render(std::span<ShapeProperty> shape_properties)
 {
-  // upload vertices to buffer
-  _sdf_buffer.append_range(vertices);
-
-  // get offset of indices
-  auto indices_offset = _sdf_buffer.size();
-  // upload indices to buffer
-  _sdf_buffer.append_range(indices);
-
-  // convert shape properties to binary data
+  // convert shape properties to binary data, write to mapped buffer directly
   uint32_t total_size{};
   for (auto const& property : shape_properties)
     total_size += ShapeProperty::header_field_count + property.values.size();
-  std::vector<uint32_t> data;
-  data.reserve(total_size);
+  auto shape_properties_allocation = _frame_buffer.allocate(total_size * sizeof(uint32_t));
+  auto out = reinterpret_cast<uint32_t*>(shape_properties_allocation.data);
   for (auto const& property : shape_properties)
   {
-    data.emplace_back(std::bit_cast<uint32_t>(property.type));
-    data.emplace_back(std::bit_cast<uint32_t>(property.color.r));
-    data.emplace_back(std::bit_cast<uint32_t>(property.color.g));
-    data.emplace_back(std::bit_cast<uint32_t>(property.color.b));
-    data.emplace_back(std::bit_cast<uint32_t>(property.color.a));
-    data.emplace_back(std::bit_cast<uint32_t>(property.thickness));
-    data.emplace_back(std::bit_cast<uint32_t>(property.op));
-    for (auto value : property.values)
-      data.emplace_back(std::bit_cast<uint32_t>(value));
+    *out++ = std::bit_cast<uint32_t>(property.type);
+    *out++ = std::bit_cast<uint32_t>(property.color.r);
+    *out++ = std::bit_cast<uint32_t>(property.color.g);
+    *out++ = std::bit_cast<uint32_t>(property.color.b);
+    *out++ = std::bit_cast<uint32_t>(property.color.a);
+    *out++ = std::bit_cast<uint32_t>(property.thickness);
+    *out++ = std::bit_cast<uint32_t>(property.op);
+    memcpy(out, property.values.data(), property.values.size() * sizeof(float));
+    out += property.values.size();
   }
-  // get offset of shape properties
-  auto shape_properties_offset = util::align_size(_sdf_buffer.size(), 8);
-  // add padding for 8 bytes alignment
-  _sdf_buffer.append_range(std::vector<std::byte>(shape_properties_offset - _sdf_buffer.size()));
-  // upload shape properties to buffer
-  _sdf_buffer.append_range(data);
   
   auto& cmd = _frames.get_command();
 
-  _sdf_buffer.upload();
-
-  auto [handle, address] = _sdf_buffer.get_handle_and_address();
+  auto batches = _quads.get_batches();
+  if (batches.empty()) return;
 
-  // bind index buffer
-  vkCmdBindIndexBuffer(cmd, handle, _sdf_buffer.get_current_frame_byte_offset() + indices_offset, VK_INDEX_TYPE_UINT16);
+  // bind index buffer, every batch uses same indices
+  vkCmdBindIndexBuffer(cmd, _quad_indices.handle(), 0, VK_INDEX_TYPE_UINT16);
 
   auto pc = PushConstant_SDF
   {
-    .vertices         = address,
-    .shape_properties = address + shape_properties_offset,
+    .vertices         = batches.front().vertices,
+    .shape_properties = shape_properties_allocation.address,
     .window_extent    = _window->get_framebuffer_size(),
   };
 
@@ -133,28 +191,160 @@ void GraphicsEngine::sdf_render(std::span<Vertex> vertices, std::span<uint16_t>
   _sdf_graphics_pipeline.bind(cmd, pc);
   _sdf_graphics_pipeline.set_pipeline_state(cmd, _swapchain.extent());
 
-  vkCmdDrawIndexed(cmd, indices.size(), 1, 0, 0, 0);
+  // one draw per block of quads
+  for (auto const& batch : batches)
+  {
+    if (pc.vertices != batch.vertices)
+    {
+      pc.vertices = batch.vertices;
+      _sdf_graphics_pipeline.push_constant(cmd, pc);
+    }
+    vkCmdDrawIndexed(cmd, batch.quad_count * 6, 1, 0, 0, 0);
+  }
 }
 
-auto GraphicsEngine::parse_text(std::string_view text, glm::vec2 pos, float size, type::FontStyle style, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices, uint32_t offset, uint16_t& idx) -> glm::vec2
+auto GraphicsEngine::parse_text(std::string_view text, glm::vec2 pos, float size, type::FontStyle style, uint32_t offset) -> glm::vec2
 {
-  auto [text_pos_info, u32str] = _text_engine.calculate_text_pos_info(text, style);
+  auto const& shaped_text = _text_engine.shape(text, style);
+  auto size_tier          = TextEngine::get_size_tier(size);
 
   // get some glyphs not cached
-  if (_text_engine.has_uncached_glyphs(u32str, style))
+  if (_text_engine.has_uncached_glyphs(shaped_text.glyphs, size_tier))
     _text_engine.generate_sdf_bitmaps();
 
-  // add vertices and indices
-  vertices.reserve(vertices.size() + u32str.size() * 4);
-  indices.reserve(indices.size() + u32str.size() * 6);
-  for (auto i = 0; i < u32str.size(); ++i)
+  // write quads to frame buffer directly, glyphs may be split into chained blocks
+  auto scale  = GlyphInfo::get_scale(size);
+  auto glyphs = std::span{ shaped_text.glyphs };
+  while (!glyphs.empty())
   {
-    auto glyph_info = _text_engine.get_cached_glyph_info(u32str[i], style);
-    vertices.append_range(glyph_info->get_vertices(pos, size, offset, text_pos_info.max_ascender, glyph_info->glyph_atlas_index)); // TODO: vertices and indices generate performance worse
-    indices.append_range(GlyphInfo::get_indices(idx));
-    pos = GlyphInfo::get_next_position(pos, size, text_pos_info.advances[i]);
+    auto out   = _quads.add(static_cast<uint32_t>(glyphs.size()));
+    auto count = out.size() / 4;
+    size_t i{};
+    // pen positions are running sum, corners of 4 quads are transformed together
+    for (; i + 4 <= count; i += 4)
+    {
+      std::array<GlyphInfo const*, 4> infos;
+      std::array<glm::vec2, 4>        positions;
+      for (uint32_t j = 0; j < 4; ++j)
+      {
+        auto const& glyph = glyphs[i + j];
+        infos[j]     = &_text_engine.get_cached_glyph_info(glyph.entry_index, size_tier);
+        positions[j] = pos + glyph.offset * scale;
+        pos          = GlyphInfo::get_next_position(pos, size, glyph.advance);
+      }
+      GlyphInfo::write_vertices(&out[i * 4], infos, positions, scale, offset, shaped_text.max_ascender);
+    }
+    for (; i < count; ++i)
+    {
+      auto const& glyph = glyphs[i];
+      _text_engine.get_cached_glyph_info(glyph.entry_index, size_tier).write_vertices(&out[i * 4], pos + glyph.offset * scale, scale, offset, shaped_text.max_ascender);
+      pos = GlyphInfo::get_next_position(pos, size, glyph.advance);
+    }
+    glyphs = glyphs.subspan(count);
   }
-  return { vertices.back().pos.x, text_pos_info.max_height * GlyphInfo::get_scale(size) };
+  return get_text_extent(shaped_text, scale);
+}
+
+auto GraphicsEngine::parse_paragraph(std::string_view text, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, type::FontStyle style, type::TextDirection direction, uint32_t offset) -> glm::vec2
+{
+  auto const& paragraph = _text_engine.layout_paragraph(text, style, width / GlyphInfo::get_scale(size), direction);
+  return add_paragraph_quads(paragraph, pos, width, size, line_height, align, visible_count, offset);
+}
+
+auto GraphicsEngine::parse_ruby_paragraph(std::string_view text, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, type::FontStyle style, uint32_t offset) -> glm::vec2
+{
+  auto const& paragraph = _text_engine.layout_ruby_paragraph(text, style, width / GlyphInfo::get_scale(size));
+  return add_paragraph_quads(paragraph, pos, width, size, line_height, align, visible_count, offset);
+}
+
+auto GraphicsEngine::add_paragraph_quads(Paragraph const& paragraph, glm::vec2 pos, float width, float size, float line_height, type::TextAlign align, uint32_t visible_count, uint32_t offset) -> glm::vec2
+{
+  auto vertical     = paragraph.direction == type::TextDirection::vertical;
+  auto scale        = GlyphInfo::get_scale(size);
+  auto size_tier    = TextEngine::get_size_tier(size);
+  auto ruby_scale   = scale * Ruby::Ruby_Scale;
+  auto ruby_tier    = TextEngine::get_size_tier(size * Ruby::Ruby_Scale);
+  auto ruby_height  = get_ruby_height(paragraph, scale);
+  auto line_advance = get_line_advance(paragraph, scale, line_height);
+
+  // only glyphs of visible characters need to be generated
+  auto visible_glyphs = std::span{ paragraph.glyphs };
+  if (visible_count < paragraph.text.size())
+    visible_glyphs = visible_glyphs.first(std::ranges::partition_point(paragraph.glyphs, [=](auto const& glyph) { return glyph.cluster < visible_count; }) - paragraph.glyphs.begin());
+  // ruby is shown after whole base is visible
+  auto visible_rubies = std::span{ paragraph.rubies };
+  visible_rubies = visible_rubies.first(std::ranges::partition_point(paragraph.rubies, [=](auto const& ruby) { return ruby.end <= visible_count; }) - paragraph.rubies.begin());
+  auto has_uncached = _text_engine.has_uncached_glyphs(visible_glyphs, size_tier);
+  for (auto const& ruby : visible_rubies)
+    has_uncached |= _text_engine.has_uncached_glyphs(ruby.glyphs, ruby_tier);
+  if (has_uncached)
+    _text_engine.generate_sdf_bitmaps();
+
+  // quads are written to frame buffer directly one by one, glyphs of trimmed characters are skipped
+
+  // ruby is centered on its base, which is always in one line
+  auto ruby_it  = visible_rubies.begin();
+  auto base_pos = glm::vec2{};
+  auto add_ruby = [&](float base_end)
+  {
+    auto ruby_pos = glm::vec2{ (base_pos.x + base_end - ruby_it->width * scale) / 2, base_pos.y - ruby_height };
+    for (auto const& glyph : ruby_it->glyphs)
+    {
+      _text_engine.get_cached_glyph_info(glyph.entry_index, ruby_tier).write_vertices(_quads.add(), ruby_pos + glyph.offset * ruby_scale, ruby_scale, offset, ruby_it->max_ascender);
+      ruby_pos.x += glyph.advance.x * ruby_scale;
+    }
+    ++ruby_it;
+  };
+
+  auto it = visible_glyphs.begin();
+  for (auto i = 0; i < paragraph.lines.size() && it != visible_glyphs.end(); ++i)
+  {
+    auto const& line = paragraph.lines[i];
+
+    // columns of vertical text are from right to left, pen is on center of column
+    auto line_pos = vertical ? glm::vec2{ pos.x - (i + 0.5f) * line_advance, pos.y } : glm::vec2{ pos.x, pos.y + ruby_height + i * line_advance };
+    auto& line_begin = vertical ? line_pos.y : line_pos.x;
+    if (align == type::TextAlign::center)
+      line_begin += (width - line.width * scale) / 2;
+    else if (align == type::TextAlign::right)
+      line_begin += width - line.width * scale;
+
+    // skip trimmed spaces and new lines between lines
+    for (; it != visible_glyphs.end() && it->cluster < line.begin; ++it);
+    for (; it != visible_glyphs.end() && it->cluster < line.end;   ++it)
+    {
+      if (ruby_it != visible_rubies.end() && it->cluster >= ruby_it->end)
+        add_ruby(line_pos.x);
+      // base begins in this glyph, which may be a cluster of several characters
+      auto next_cluster = std::next(it) != visible_glyphs.end() ? std::next(it)->cluster : line.end;
+      if (ruby_it != visible_rubies.end() && it->cluster <= ruby_it->begin && ruby_it->begin < next_cluster)
+        base_pos = line_pos;
+
+      _text_engine.get_cached_glyph_info(it->entry_index, size_tier).write_vertices(_quads.add(), line_pos + it->offset * scale, scale, offset, vertical ? 0.f : paragraph.max_ascender);
+      line_pos = GlyphInfo::get_next_position(line_pos, size, it->advance);
+    }
+    // base at end of line
+    if (ruby_it != visible_rubies.end() && ruby_it->begin < line.end && ruby_it->end <= line.end)
+      add_ruby(line_pos.x);
+  }
+  return get_paragraph_extent(paragraph, scale, line_height);
+}
+
+auto GraphicsEngine::measure_text(std::string_view text, float size, type::FontStyle style) -> glm::vec2
+{
+  return get_text_extent(_text_engine.shape(text, style, TextUse::measure), GlyphInfo::get_scale(size));
+}
+
+auto GraphicsEngine::measure_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style, type::TextDirection direction) -> glm::vec2
+{
+  auto scale = GlyphInfo::get_scale(size);
+  return get_paragraph_extent(_text_engine.layout_paragraph(text, style, width / scale, direction, TextUse::measure), scale, line_height);
+}
+
+auto GraphicsEngine::measure_ruby_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style) -> glm::vec2
+{
+  auto scale = GlyphInfo::get_scale(size);
+  return get_paragraph_extent(_text_engine.layout_ruby_paragraph(text, style, width / scale), scale, line_height);
 }
 
 }}
\ No newline at end of file
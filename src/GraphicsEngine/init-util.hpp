@@ -213,6 +213,24 @@ struct QueueFamilyIndices
   }
 };
 
+// dedicated transfer queue family runs uploads asynchronously with graphics queue
+inline auto get_transfer_queue_family(VkPhysicalDevice device) -> std::optional<uint32_t>
+{
+  auto queue_families = get_supported_queue_families(device);
+  std::optional<uint32_t> res;
+  for (uint32_t i = 0; i < queue_families.size(); ++i)
+  {
+    auto flags = queue_families[i].queueFlags;
+    if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+      continue;
+    // family only for transfer is usually dma engine
+    if (!(flags & VK_QUEUE_COMPUTE_BIT))
+      return i;
+    if (!res) res = i;
+  }
+  return res;
+}
+
 inline auto get_queue_family_indices(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
   auto queue_families = get_supported_queue_families(device);
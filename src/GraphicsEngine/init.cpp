@@ -10,7 +10,7 @@
 
 namespace tk { namespace graphics_engine { 
 
-void GraphicsEngine::init(Window& window)
+void GraphicsEngine::init(Window& window, uint32_t frames_in_flight)
 {
   // only have single graphics engine
   static bool first = true;
@@ -33,7 +33,7 @@ void GraphicsEngine::init(Window& window)
   init_memory_allocator();
   create_sampler();
 
-  create_frame_resources();
+  create_frame_resources(frames_in_flight);
 
   init_text_engine();
   init_sdf_resources();
@@ -132,13 +132,16 @@ void GraphicsEngine::select_physical_device()
 
 void GraphicsEngine::create_device_and_get_queues()
 {
-  auto queue_families = get_queue_family_indices(_physical_device, _surface);
+  auto queue_families  = get_queue_family_indices(_physical_device, _surface);
+  auto transfer_family = get_transfer_queue_family(_physical_device);
   // if graphic and present family are same index, indices will be one
   std::set<uint32_t> indices
   {
     queue_families.graphics_family.value(),
     queue_families.present_family.value(),
   };
+  if (transfer_family)
+    indices.emplace(transfer_family.value());
 
   float priority = 1.0f;
 
@@ -178,12 +181,28 @@ void GraphicsEngine::create_device_and_get_queues()
   //
   vkGetDeviceQueue(_device, queue_families.graphics_family.value(), 0, &_graphics_queue);
   vkGetDeviceQueue(_device, queue_families.present_family.value(), 0, &_present_queue);
+
+  // without dedicated transfer queue, uploads are recorded in graphics command
+  if (transfer_family)
+  {
+    VkQueue transfer_queue;
+    vkGetDeviceQueue(_device, transfer_family.value(), 0, &transfer_queue);
+    _transfer_queue.init(_device, transfer_family.value(), transfer_queue);
+  }
 }
 
 void GraphicsEngine::init_memory_allocator()
 {
   _mem_alloc.init(_physical_device, _device, _instance, config()->vulkan_version);
   _destructors.push([this] { _mem_alloc.destroy(); });
+
+  // uploaded images are written by transfer queue and sampled by graphics queue
+  if (_transfer_queue.valid())
+  {
+    _mem_alloc.set_upload_queue_families({ get_queue_family_indices(_physical_device, _surface).graphics_family.value(), _transfer_queue.family() });
+    // destroyed before memory allocator, retired staging blocks are freed by it
+    _destructors.push([this] { _transfer_queue.destroy(); });
+  }
 }
 
 void GraphicsEngine::create_swapchain()
@@ -200,10 +219,13 @@ void GraphicsEngine::init_command_pool()
   _destructors.push([this] { _command_pool.destroy(); });
 }
 
-void GraphicsEngine::create_frame_resources()
+void GraphicsEngine::create_frame_resources(uint32_t frames_in_flight)
 {
-  _frames.init(_device, _command_pool, &_swapchain);
+  _frames.init(_device, _command_pool, &_swapchain, frames_in_flight);
   _destructors.push([&] { _frames.destroy(); });
+
+  // old allocations of growing buffers are destroyed after frames using them finished
+  _mem_alloc.set_retire_hook([this](InplaceFunction<void()>&& func, VkDeviceSize bytes) { _frames.push_old_resource(std::move(func), bytes); });
 }
 
 auto GraphicsEngine::get_swapchain_image_size() -> glm::vec2
@@ -216,6 +238,7 @@ auto GraphicsEngine::get_swapchain_image_size() -> glm::vec2
 void GraphicsEngine::resize_swapchain()
 {
   _swapchain.resize();
+  _frames.resize_submit_semaphores();
 }
 
 void GraphicsEngine::create_sampler()
@@ -237,14 +260,19 @@ void GraphicsEngine::create_sampler()
 
 void GraphicsEngine::init_text_engine()
 {
-  _text_engine.init(_mem_alloc);
+  _text_engine.init(_mem_alloc, static_cast<uint32_t>(_frames.size()), _transfer_queue.valid() ? &_transfer_queue : nullptr);
   _destructors.push([&] { _text_engine.destroy(); });
 }
 
-void GraphicsEngine::load_fonts(std::vector<std::string_view> const& fonts)
+void GraphicsEngine::load_fonts(std::vector<std::string_view> const& fonts, type::FontRenderMode render_mode)
 {
   for (auto const& font : fonts)
-    _text_engine.load_font(font);
+    _text_engine.load_font(font, render_mode);
+}
+
+void GraphicsEngine::load_fonts_async(std::vector<std::string_view> const& fonts, type::FontRenderMode render_mode)
+{
+  _text_engine.load_fonts_async({ fonts.begin(), fonts.end() }, render_mode);
 }
 
 void GraphicsEngine::init_gpu_resource()
@@ -253,10 +281,10 @@ void GraphicsEngine::init_gpu_resource()
 
   // offscreen image creatation
   //auto extent = _swapchain.extent();
-  //_offscreen_image = _mem_alloc.create_image(_swapchain.format(), extent.width, extent.height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+  //_offscreen_image = _mem_alloc.create_image(_swapchain.format(), extent.width, extent.height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, ImageClass::transient);
 
   // preload glyphs
-  _text_engine.preload_glyphs(cmd);
+  _text_engine.preload_builtin_glyphs(cmd);
 
   cmd.end().submit_wait_free(_command_pool, _graphics_queue);
 
@@ -268,11 +296,16 @@ void GraphicsEngine::init_gpu_resource()
 
 void GraphicsEngine::init_sdf_resources()
 {
-  _sdf_buffer.init(&_frames, &_mem_alloc);
+  _frame_buffer.init(&_frames, &_mem_alloc);
+  _quads.init(&_frame_buffer);
+  // quads of every batch have same indices, write them once
+  _quad_indices = _mem_alloc.create_buffer(QuadWriter::Max_Block_Quad_Count * 6 * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+  uint16_t first_index{};
+  GlyphInfo::write_indices(static_cast<uint16_t*>(_quad_indices.data()), QuadWriter::Max_Block_Quad_Count, first_index);
   _sdf_graphics_pipeline.init({
     _device,
     {
-      { ShaderType::fragment, 0, DescriptorType::sampler2D, _text_engine.get_glyph_atlases(), _sampler },
+      { ShaderType::fragment, 0, DescriptorType::sampler2D, _text_engine.get_glyph_atlases(), _sampler, _text_engine.get_glyph_atlas_layout() },
     },
     sizeof(PushConstant_SDF),
     _swapchain.format(),
@@ -282,7 +315,8 @@ void GraphicsEngine::init_sdf_resources()
 
   _destructors.push([&]
   {
-    _sdf_buffer.destroy();
+    _frame_buffer.destroy();
+    _quad_indices.destroy();
     _sdf_graphics_pipeline.destroy();
   });
 }
@@ -0,0 +1,98 @@
+//
+// inplace function
+//
+// move only type erased callable stored in fixed buffer, never allocates.
+// callable bigger than capacity fails to compile, capture handles instead of whole objects.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+
+namespace tk
+{
+
+  template <typename Signature, std::size_t Capacity = 48>
+  class InplaceFunction;
+
+  template <typename R, typename... Args, std::size_t Capacity>
+  class InplaceFunction<R(Args...), Capacity>
+  {
+  public:
+    InplaceFunction()  = default;
+    ~InplaceFunction() { reset(); }
+
+    template <typename F>
+    requires (!std::is_same_v<std::remove_cvref_t<F>, InplaceFunction> &&
+              std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    InplaceFunction(F&& func)
+    {
+      using Callable = std::decay_t<F>;
+      static_assert(sizeof(Callable)  <= Capacity,                 "callable is bigger than capacity");
+      static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable is over aligned");
+      static_assert(std::is_nothrow_move_constructible_v<Callable>, "callable should be nothrow movable");
+
+      new (_storage) Callable(std::forward<F>(func));
+      _invoke = [](void* storage, Args&&... args) -> R
+      {
+        return (*static_cast<Callable*>(storage))(std::forward<Args>(args)...);
+      };
+      // move src to dst if dst is not null, then destroy src
+      _manage = [](void* dst, void* src) noexcept
+      {
+        auto callable = static_cast<Callable*>(src);
+        if (dst) new (dst) Callable(std::move(*callable));
+        callable->~Callable();
+      };
+    }
+
+    InplaceFunction(InplaceFunction const&)            = delete;
+    InplaceFunction& operator=(InplaceFunction const&) = delete;
+
+    InplaceFunction(InplaceFunction&& other) noexcept { move_from(other); }
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept
+    {
+      if (this != &other)
+      {
+        reset();
+        move_from(other);
+      }
+      return *this;
+    }
+
+    auto operator()(Args... args) -> R
+    {
+      assert(_invoke);
+      return _invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return _invoke != nullptr; }
+
+    void reset() noexcept
+    {
+      if (!_manage) return;
+      _manage(nullptr, _storage);
+      _invoke = nullptr;
+      _manage = nullptr;
+    }
+
+  private:
+    void move_from(InplaceFunction& other) noexcept
+    {
+      if (!other._manage) return;
+      other._manage(_storage, other._storage);
+      _invoke = std::exchange(other._invoke, nullptr);
+      _manage = std::exchange(other._manage, nullptr);
+    }
+
+  private:
+    alignas(std::max_align_t) std::byte _storage[Capacity];
+    R    (*_invoke)(void*, Args&&...)    {};
+    void (*_manage)(void*, void*) noexcept {};
+  };
+
+}
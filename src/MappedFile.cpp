@@ -0,0 +1,95 @@
+#include "MappedFile.hpp"
+#include "ErrorHandling.hpp"
+
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tk { namespace util {
+
+#ifdef _WIN32
+
+auto MappedFile::open(std::string_view path) -> MappedFile
+{
+  // convert utf-8 path to wide string
+  auto size = MultiByteToWideChar(CP_UTF8, 0, path.data(), path.size(), nullptr, 0);
+  std::wstring wpath(size, 0);
+  MultiByteToWideChar(CP_UTF8, 0, path.data(), path.size(), wpath.data(), size);
+
+  auto file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  throw_if(file == INVALID_HANDLE_VALUE, "[MappedFile] failed to open {}: {}", path, GetLastError());
+
+  LARGE_INTEGER file_size{};
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    throw_if(true, "[MappedFile] failed to get size of {}", path);
+  }
+
+  auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  throw_if(mapping == nullptr, "[MappedFile] failed to create mapping of {}: {}", path, GetLastError());
+
+  // view keeps mapping alive
+  auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  throw_if(data == nullptr, "[MappedFile] failed to map {}: {}", path, GetLastError());
+
+  MappedFile mapped_file;
+  mapped_file._data = static_cast<uint8_t const*>(data);
+  mapped_file._size = static_cast<size_t>(file_size.QuadPart);
+  return mapped_file;
+}
+
+void MappedFile::close() noexcept
+{
+  if (_data)
+    UnmapViewOfFile(_data);
+  _data = {};
+  _size = {};
+}
+
+#else
+
+auto MappedFile::open(std::string_view path) -> MappedFile
+{
+  auto fd = ::open(std::string{ path }.c_str(), O_RDONLY);
+  throw_if(fd == -1, "[MappedFile] failed to open {}", path);
+
+  struct stat st{};
+  if (fstat(fd, &st) == -1 || st.st_size == 0)
+  {
+    ::close(fd);
+    throw_if(true, "[MappedFile] failed to get size of {}", path);
+  }
+
+  // mapping keeps file alive
+  auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  throw_if(data == MAP_FAILED, "[MappedFile] failed to map {}", path);
+
+  MappedFile mapped_file;
+  mapped_file._data = static_cast<uint8_t const*>(data);
+  mapped_file._size = static_cast<size_t>(st.st_size);
+  return mapped_file;
+}
+
+void MappedFile::close() noexcept
+{
+  if (_data)
+    munmap(const_cast<uint8_t*>(_data), _size);
+  _data = {};
+  _size = {};
+}
+
+#endif
+
+}}
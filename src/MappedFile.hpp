@@ -0,0 +1,36 @@
+//
+// mapped file
+//
+// read only memory mapped file, pages are loaded by os when first accessed,
+// so opening a large file (such as cjk font) not need to read whole file.
+// view keeps valid until close, handles of file and mapping are released after mapped.
+//
+
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace tk { namespace util {
+
+  class MappedFile
+  {
+  public:
+    /**
+     * map whole file as read only
+     * @param path utf-8 path
+     * @throw std::runtime_error failed to open or map
+     */
+    static auto open(std::string_view path) -> MappedFile;
+    void close() noexcept;
+
+    auto data() const noexcept { return _data; }
+    auto size() const noexcept { return _size; }
+
+  private:
+    uint8_t const* _data{};
+    size_t         _size{};
+  };
+
+}}
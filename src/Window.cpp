@@ -143,14 +143,14 @@ LRESULT WINAPI window_process_callback(HWND handle, UINT msg, WPARAM w_param, LP
   case WM_ENTERSIZEMOVE:
   {
     SetTimer(handle, Move_Timer, 1, nullptr);
-    window->_engine->wait_fence(false);
+    window->_engine->wait_frame(false);
   }
   break;
 
   case WM_EXITSIZEMOVE:
   {
     KillTimer(handle, Move_Timer);
-    window->_engine->wait_fence(true);
+    window->_engine->wait_frame(true);
   }
   break;
 
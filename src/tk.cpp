@@ -28,12 +28,12 @@ struct tk_context
 static tk_context* tk_ctx{};
 extern struct ui_context ui_ctx;
 
-void init(std::string_view title, uint32_t width, uint32_t height)
+void init(std::string_view title, uint32_t width, uint32_t height, uint32_t frames_in_flight)
 {
   tk_ctx = new tk_context();
 
   tk_ctx->window.init(title, width, height);
-  tk_ctx->engine.init(tk_ctx->window);
+  tk_ctx->engine.init(tk_ctx->window, frames_in_flight);
   tk_ctx->window.set_engine(&tk_ctx->engine);
 
   tk_ctx->window.set_state(type::WindowState::running); // set running to avoid event process always jump the rendering
@@ -66,14 +66,14 @@ auto get_key(type::Key k) -> type::KeyState
   return tk_ctx->window.get_key(k);
 }
 
-void render()
+auto render() -> type::FrameResult
 {
   auto& engine = tk_ctx->engine;
 
-  if (!engine.frame_begin())
+  if (auto result = engine.frame_begin(); result != graphics_engine::AcquireResult::success)
   {
     ui::clear();
-    return;
+    return result == graphics_engine::AcquireResult::not_ready ? type::FrameResult::gpu_busy : type::FrameResult::out_of_date;
   }
 
   engine.sdf_render_begin();
@@ -89,6 +89,7 @@ void render()
     tk_ctx->window.show();
     is_first_frame = false;
   }
+  return type::FrameResult::rendered;
 }
 
 void destroy()
@@ -98,9 +99,54 @@ void destroy()
   delete tk_ctx;
 }
 
-void load_fonts(std::vector<std::string_view> fonts)
+void load_fonts(std::vector<std::string_view> fonts, type::FontRenderMode render_mode)
 {
-  tk_ctx->engine.load_fonts(fonts);
+  tk_ctx->engine.load_fonts(fonts, render_mode);
+}
+
+void load_fonts_async(std::vector<std::string_view> fonts, type::FontRenderMode render_mode)
+{
+  tk_ctx->engine.load_fonts_async(fonts, render_mode);
+}
+
+auto is_loading_fonts() -> bool
+{
+  return tk_ctx->engine.is_loading_fonts();
+}
+
+void preload_glyphs(std::string_view text, type::FontStyle style, float size)
+{
+  tk_ctx->engine.preload_glyphs(text, style, size);
+}
+
+void set_glyph_generation_budget(float milliseconds)
+{
+  tk_ctx->engine.set_glyph_generation_budget(milliseconds);
+}
+
+void prepare_texts(std::vector<std::string_view> const& texts, float size, float width, type::FontStyle style, type::TextDirection direction)
+{
+  tk_ctx->engine.prepare_texts(texts, size, width, style, direction);
+}
+
+auto get_frame() -> uint64_t
+{
+  return tk_ctx->engine.get_frame_value();
+}
+
+auto is_frame_complete(uint64_t frame) -> bool
+{
+  return tk_ctx->engine.is_frame_complete(frame);
+}
+
+auto get_memory_stats() -> type::MemoryStats
+{
+  return tk_ctx->engine.get_memory_stats();
+}
+
+void set_memory_budget(uint64_t bytes, std::function<void(type::MemoryStats const&)> callback)
+{
+  tk_ctx->engine.set_memory_budget(bytes, std::move(callback));
 }
 
 }
\ No newline at end of file
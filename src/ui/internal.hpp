@@ -51,9 +51,6 @@ struct ui_context
   std::vector<glm::vec2>              current_hovered_widget_rect{};
   std::pair<std::string, std::string> last_hovered_widget{};
 
-  std::vector<graphics_engine::Vertex>        vertices;
-  std::vector<uint16_t>                       indices;
-  uint16_t                                    index{};
   std::vector<graphics_engine::ShapeProperty> shape_properties;
   uint32_t                                    shape_offset{};
 
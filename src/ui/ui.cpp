@@ -74,9 +74,7 @@ void clear()
 {
   auto ctx = get_ctx();
 
-  ctx->vertices.clear();
-  ctx->indices.clear();
-  ctx->index = {};
+  ctx->engine->get_quads().clear();
   ctx->shape_properties.clear();
   ctx->shape_offset = {};
 
@@ -96,7 +94,7 @@ void render()
   if (ctx->shape_properties.empty()) return;
   assert(ctx->engine && ctx->shape_properties.back().op == type::ShapeOp::mix);
   assert(ctx->engine);
-  ctx->engine->sdf_render(ctx->vertices, ctx->indices, ctx->shape_properties);
+  ctx->engine->sdf_render(ctx->shape_properties);
   
   clear();
 }
@@ -127,22 +125,12 @@ void add_vertices(std::pair<glm::vec2, glm::vec2> const& box, uint32_t offset)
   auto  min = pos + box.first  - glm::vec2(1);
   auto  max = pos + box.second + glm::vec2(1);
 
-  ctx->vertices.reserve(ctx->vertices.size() + 4);
-  ctx->vertices.append_range(std::vector<Vertex>
-  {
-    { min,              {}, offset },
-    { { max.x, min.y }, {}, offset },
-    { max,              {}, offset },
-    { { min.x, max.y }, {}, offset },
-  });
-
-  ctx->indices.reserve(ctx->indices.size() + 6);
-  ctx->indices.append_range(std::vector<uint16_t>
-  {
-    static_cast<uint16_t>(ctx->index + 0), static_cast<uint16_t>(ctx->index + 1), static_cast<uint16_t>(ctx->index + 3),
-    static_cast<uint16_t>(ctx->index + 3), static_cast<uint16_t>(ctx->index + 1), static_cast<uint16_t>(ctx->index + 2),
-  });
-  ctx->index += 4;
+  // write to frame buffer directly, vertex order is same as glyph quad which indices are shared
+  auto out = ctx->engine->get_quads().add();
+  out[0] = { min,              {}, offset };
+  out[1] = { { max.x, min.y }, {}, offset };
+  out[2] = { { min.x, max.y }, {}, offset };
+  out[3] = { max,              {}, offset };
 }
 
 void add_shape_property(type::Shape type, std::vector<float> const& values, uint32_t color, uint32_t thickness = 0, type::ShapeOp op = type::ShapeOp::mix)
@@ -322,7 +310,7 @@ auto text_impl(std::string_view text, glm::vec2 const& pos, float size, uint32_t
   if (text.empty()) return {};
   auto ctx = get_ctx();
   assert(ctx->begining && ctx->path_begining == false && ctx->union_start == false);
-  auto extent = ctx->engine->parse_text(text, pos, size, style, ctx->vertices, ctx->indices, ctx->shape_offset, ctx->index);
+  auto extent = ctx->engine->parse_text(text, pos, size, style, ctx->shape_offset);
   add_text_property(type::Shape::glyph, inner_color, outer_color);
   return extent;
 }
@@ -337,6 +325,60 @@ auto text(std::string_view text, glm::vec2 const& pos, float size, uint32_t inne
   return text_impl(text, pos, size, inner_color, type::FontStyle::regular, outer_color);
 }
 
+auto paragraph(std::string_view text, glm::vec2 const& pos, float width, float size, uint32_t color, type::TextAlign align, float line_height, uint32_t visible_count, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  auto ctx = get_ctx();
+  assert(ctx->begining && ctx->path_begining == false && ctx->union_start == false);
+  auto extent = ctx->engine->parse_paragraph(text, pos, width, size, line_height, align, visible_count, style, type::TextDirection::horizontal, ctx->shape_offset);
+  add_text_property(type::Shape::glyph, color, 0);
+  return extent;
+}
+
+auto vertical_paragraph(std::string_view text, glm::vec2 const& pos, float height, float size, uint32_t color, type::TextAlign align, float line_height, uint32_t visible_count, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  auto ctx = get_ctx();
+  assert(ctx->begining && ctx->path_begining == false && ctx->union_start == false);
+  auto extent = ctx->engine->parse_paragraph(text, pos, height, size, line_height, align, visible_count, style, type::TextDirection::vertical, ctx->shape_offset);
+  add_text_property(type::Shape::glyph, color, 0);
+  return extent;
+}
+
+auto ruby_paragraph(std::string_view text, glm::vec2 const& pos, float width, float size, uint32_t color, type::TextAlign align, float line_height, uint32_t visible_count, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  auto ctx = get_ctx();
+  assert(ctx->begining && ctx->path_begining == false && ctx->union_start == false);
+  auto extent = ctx->engine->parse_ruby_paragraph(text, pos, width, size, line_height, align, visible_count, style, ctx->shape_offset);
+  add_text_property(type::Shape::glyph, color, 0);
+  return extent;
+}
+
+auto measure_text(std::string_view text, float size, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  return get_ctx()->engine->measure_text(text, size, style);
+}
+
+auto measure_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  return get_ctx()->engine->measure_paragraph(text, width, size, line_height, style, type::TextDirection::horizontal);
+}
+
+auto measure_vertical_paragraph(std::string_view text, float height, float size, float line_height, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  return get_ctx()->engine->measure_paragraph(text, height, size, line_height, style, type::TextDirection::vertical);
+}
+
+auto measure_ruby_paragraph(std::string_view text, float width, float size, float line_height, type::FontStyle style) -> glm::vec2
+{
+  if (text.empty()) return {};
+  return get_ctx()->engine->measure_ruby_paragraph(text, width, size, line_height, style);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                             Mouse Operation
 ////////////////////////////////////////////////////////////////////////////////
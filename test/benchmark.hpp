@@ -0,0 +1,57 @@
+//
+// benchmark
+//
+// timings are printed, they are measured on machine running it, no result is compared.
+//
+
+#pragma once
+
+#include "test.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string_view>
+
+namespace tk { namespace test {
+
+/**
+ * run func repeatedly until both min runs and min time are reached
+ * @return average milliseconds of a run
+ */
+template <typename F>
+auto measure(F&& func, uint32_t min_runs = 10, std::chrono::milliseconds min_time = std::chrono::milliseconds{ 500 }) -> double
+{
+  using clock = std::chrono::steady_clock;
+  // first run warms caches and creates lazily resources
+  func();
+  uint32_t runs{};
+  auto     start = clock::now();
+  auto     now   = start;
+  for (; runs < min_runs || now - start < min_time; ++runs)
+  {
+    func();
+    now = clock::now();
+  }
+  return std::chrono::duration<double, std::milli>(now - start).count() / runs;
+}
+
+inline void report(std::string_view name, double milliseconds, std::string_view detail = {})
+{
+  std::println("{:<40} {:>10.3f} ms  {}", name, milliseconds, detail);
+}
+
+// discard quads written by benchmark and render empty frame, so frame buffer is released
+inline void next_frame(graphics_engine::GraphicsEngine& engine)
+{
+  engine.get_quads().clear();
+  tk::render();
+}
+
+// bytes per millisecond to GiB per second
+inline auto to_gib_per_second(double bytes, double milliseconds) noexcept
+{
+  return bytes / milliseconds * 1000 / (1024. * 1024 * 1024);
+}
+
+}}
@@ -0,0 +1,54 @@
+//
+// time to first frame when fonts are loaded synchronously or on worker thread
+//
+
+#include "benchmark.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <string_view>
+
+using namespace tk;
+using namespace std::string_view_literals;
+
+int main(int argc, char** argv)
+{
+  // engine is only initialized once in a process, every mode runs in its own process
+  if (argc < 2)
+  {
+    for (auto mode : { "sync", "async" })
+      if (std::system(std::format("\"{}\" {}", argv[0], mode).c_str()) != 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+  }
+  auto async = argv[1] == "async"sv;
+
+  using clock = std::chrono::steady_clock;
+  auto since  = [start = clock::now()] { return std::chrono::duration<double, std::milli>(clock::now() - start).count(); };
+
+  auto& engine = test::init_engine();
+  auto  init   = since();
+
+  std::vector fonts{ test::get_font_path(), test::get_cjk_font_path() };
+  if (async)
+    tk::load_fonts_async(fonts);
+  else
+    tk::load_fonts(fonts);
+
+  // first frame is rendered and shown without fonts when loading asynchronously
+  tk::render();
+  engine.wait_device_complete();
+  auto first_frame = since();
+
+  // loaded fonts are published at frame begin
+  while (tk::is_loading_fonts())
+    tk::render();
+  auto fonts_ready = since();
+
+  test::report(std::format("{}: init", argv[1]),        init);
+  test::report(std::format("{}: first frame", argv[1]), first_frame);
+  test::report(std::format("{}: fonts ready", argv[1]), fonts_ready);
+
+  tk::destroy();
+}
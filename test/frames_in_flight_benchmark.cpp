@@ -0,0 +1,93 @@
+//
+// memory and latency of frames in flight,
+// every frame in flight has its own per-frame buffers, and cpu runs further ahead of gpu.
+// latency is from submitting frame to finding it complete, which is checked after every frame,
+// so it is measured at resolution of a frame.
+//
+
+#include "benchmark.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <format>
+#include <string>
+
+using namespace tk;
+
+namespace {
+
+constexpr uint32_t Frame_Count = 600;
+
+}
+
+int main(int argc, char** argv)
+{
+  // engine is only initialized once in a process, every frame count runs in its own process
+  if (argc < 2)
+  {
+    for (uint32_t frames_in_flight = 1; frames_in_flight <= 4; ++frames_in_flight)
+      if (std::system(std::format("\"{}\" {}", argv[0], frames_in_flight).c_str()) != 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+  }
+  auto frames_in_flight = static_cast<uint32_t>(std::stoul(argv[1]));
+
+  using clock = std::chrono::steady_clock;
+  auto to_ms  = [](clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+
+  auto& engine = test::init_engine(800, 600, frames_in_flight);
+  engine.load_fonts({ test::get_font_path() }, type::FontRenderMode::sdf);
+  engine.set_glyph_generation_budget(1000.f);
+
+  struct Submitted
+  {
+    uint64_t          frame{};
+    clock::time_point time;
+  };
+  std::deque<Submitted> submitted;
+  double latency{};
+  uint32_t completed{};
+  auto check_complete = [&]
+  {
+    auto now = clock::now();
+    while (!submitted.empty() && tk::is_frame_complete(submitted.front().frame))
+    {
+      latency += to_ms(now - submitted.front().time);
+      ++completed;
+      submitted.pop_front();
+    }
+  };
+
+  // some text every frame, so gpu has work and per-frame buffers are used
+  auto draw = [&]
+  {
+    for (uint32_t i = 0; i < 20; ++i)
+      engine.parse_text("The quick brown fox jumps over the lazy dog 0123456789", { 10.f, 10.f + i * 28.f }, 24.f, type::FontStyle::regular, 0);
+    auto frame = tk::get_frame();
+    tk::render();
+    submitted.emplace_back(frame, clock::now());
+    check_complete();
+  };
+
+  // glyphs are generated and buffers grow to their size in first frames
+  for (uint32_t i = 0; i < 60; ++i) draw();
+  engine.wait_device_complete();
+  check_complete();
+  latency   = {};
+  completed = {};
+
+  auto start = clock::now();
+  for (uint32_t i = 0; i < Frame_Count; ++i) draw();
+  auto frame_time = to_ms(clock::now() - start) / Frame_Count;
+
+  auto stats   = tk::get_memory_stats();
+  auto dynamic = stats.categories[static_cast<uint32_t>(type::MemoryCategory::dynamic)];
+
+  test::report(std::format("{} frames in flight: frame", frames_in_flight),   frame_time);
+  test::report(std::format("{} frames in flight: latency", frames_in_flight), latency / completed);
+  std::println("{} frames in flight: dynamic memory {:.1f} KiB in {} allocations, total {:.1f} MiB",
+               frames_in_flight, dynamic.bytes / 1024., dynamic.allocation_count, stats.used_bytes / (1024. * 1024));
+
+  tk::destroy();
+}
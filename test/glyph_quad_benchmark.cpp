@@ -0,0 +1,58 @@
+//
+// writing glyph quads by scalar path, simd path of single glyph and simd path of 4 glyphs
+//
+
+#include "benchmark.hpp"
+
+#include <format>
+#include <random>
+#include <vector>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr uint32_t Glyph_Count = 1 << 16;
+
+}
+
+int main()
+{
+  std::mt19937                          rng{ 1 };
+  std::uniform_real_distribution<float> dist{ 0.f, 100.f };
+
+  std::vector<GlyphInfo> glyphs;
+  std::vector<glm::vec2> positions;
+  for (uint32_t i = 0; i < Glyph_Count; ++i)
+  {
+    glyphs.emplace_back(i % 8, glm::vec2{ dist(rng), dist(rng) }, glm::vec2{ dist(rng), dist(rng) }, dist(rng), dist(rng));
+    positions.emplace_back(i * 10.f, dist(rng));
+  }
+  std::vector<Vertex> vertices(Glyph_Count * 4);
+  auto scale = 0.75f;
+
+  auto scalar = test::measure([&]
+  {
+    for (uint32_t i = 0; i < Glyph_Count; ++i)
+      glyphs[i].write_vertices_scalar(&vertices[i * 4], positions[i], scale, 0, 24.f);
+  });
+  auto single = test::measure([&]
+  {
+    for (uint32_t i = 0; i < Glyph_Count; ++i)
+      glyphs[i].write_vertices(&vertices[i * 4], positions[i], scale, 0, 24.f);
+  });
+  auto batched = test::measure([&]
+  {
+    for (uint32_t i = 0; i < Glyph_Count; i += 4)
+    {
+      GlyphInfo::write_vertices(&vertices[i * 4], { &glyphs[i], &glyphs[i + 1], &glyphs[i + 2], &glyphs[i + 3] },
+                                { positions[i], positions[i + 1], positions[i + 2], positions[i + 3] }, scale, 0, 24.f);
+    }
+  });
+
+  auto per_glyph = [](double ms) { return std::format("{:.2f} ns/glyph", ms * 1e6 / Glyph_Count); };
+  test::report("scalar",         scalar,  per_glyph(scalar));
+  test::report("single glyph",   single,  per_glyph(single));
+  test::report("batch 4 glyphs", batched, per_glyph(batched));
+}
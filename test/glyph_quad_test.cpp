@@ -0,0 +1,50 @@
+//
+// simd and batched writing of glyph quads are bit identical to scalar path
+//
+
+#include "test.hpp"
+
+#include <cstring>
+#include <random>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+int main()
+{
+  std::mt19937                          rng{ 1 };
+  std::uniform_real_distribution<float> dist{ -100.f, 100.f };
+
+  for (uint32_t n = 0; n < 10000; ++n)
+  {
+    std::array<GlyphInfo, 4>        glyphs;
+    std::array<GlyphInfo const*, 4> infos;
+    std::array<glm::vec2, 4>        positions;
+    auto scale    = dist(rng) / 37.f;
+    auto ascender = dist(rng);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+      glyphs[i]    = GlyphInfo{ i, { dist(rng) + 200.f, dist(rng) + 200.f }, { dist(rng), dist(rng) }, dist(rng), dist(rng), dist(rng) / 10.f };
+      infos[i]     = &glyphs[i];
+      positions[i] = { dist(rng), dist(rng) };
+    }
+    // sign of zero is kept
+    if (n % 7 == 0)
+    {
+      positions[0].x         = -0.f;
+      glyphs[0].pos_offset.x = 0.f;
+    }
+
+    Vertex scalar[16]{}, single[16]{}, batched[16]{};
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+      glyphs[i].write_vertices_scalar(scalar + i * 4, positions[i], scale, n, ascender);
+      glyphs[i].write_vertices(single + i * 4, positions[i], scale, n, ascender);
+    }
+    GlyphInfo::write_vertices(batched, infos, positions, scale, n, ascender);
+    TK_EXPECT(memcmp(scalar, single,  sizeof(scalar)) == 0);
+    TK_EXPECT(memcmp(scalar, batched, sizeof(scalar)) == 0);
+  }
+
+  return test::result();
+}
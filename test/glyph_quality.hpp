@@ -0,0 +1,127 @@
+//
+// glyph quality
+//
+// quality of distance field bitmap is error of coverage reconstructed from it,
+// against coverage rasterized by freetype in render size.
+//
+
+#pragma once
+
+#include "test.hpp"
+#include "GraphicsEngine/TextEngine/TextEngine.hpp"
+#include "GraphicsEngine/TextEngine/MSDF.hpp"
+#include "ErrorHandling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <vector>
+
+namespace tk { namespace test {
+
+// antialiased coverage of glyph, offsets are from pen position on baseline
+struct Coverage
+{
+  std::vector<uint8_t> data;
+  int32_t              width{};
+  int32_t              height{};
+  int32_t              left{};
+  int32_t              top{};
+};
+
+// face of reference rasterization, unhinted same as distance fields
+class ReferenceFace
+{
+public:
+  ReferenceFace(FT_Library ft, std::string_view path)
+  {
+    _file = util::MappedFile::open(path);
+    throw_if(FT_New_Memory_Face(ft, _file.data(), _file.size(), 0, &_face), "failed to load reference face");
+  }
+  ~ReferenceFace()
+  {
+    FT_Done_Face(_face);
+    _file.close();
+  }
+  ReferenceFace(ReferenceFace const&)            = delete;
+  ReferenceFace& operator=(ReferenceFace const&) = delete;
+
+  auto rasterize(uint32_t glyph_index, uint32_t size) -> Coverage
+  {
+    throw_if(FT_Set_Pixel_Sizes(_face, 0, size), "failed to set pixel size");
+    throw_if(FT_Load_Glyph(_face, glyph_index, FT_LOAD_RENDER | FT_LOAD_NO_HINTING), "failed to render glyph");
+    auto const& bitmap = _face->glyph->bitmap;
+    Coverage coverage{ {}, static_cast<int32_t>(bitmap.width), static_cast<int32_t>(bitmap.rows), _face->glyph->bitmap_left, _face->glyph->bitmap_top };
+    coverage.data.resize(bitmap.width * bitmap.rows);
+    for (uint32_t y = 0; y < bitmap.rows; ++y)
+      std::copy_n(bitmap.buffer + y * bitmap.pitch, bitmap.width, coverage.data.data() + y * bitmap.width);
+    return coverage;
+  }
+
+private:
+  util::MappedFile _file;
+  FT_Face          _face{};
+};
+
+// distance of texel in [-0.5, 0.5], 0 on edge, median of three channels for msdf
+inline auto get_distance(graphics_engine::SDFBitmap const& bitmap, int32_t x, int32_t y) -> float
+{
+  auto width  = static_cast<int32_t>(bitmap.extent.x);
+  auto height = static_cast<int32_t>(bitmap.extent.y);
+  if (x < 0 || y < 0 || x >= width || y >= height) return -0.5f;
+
+  auto texel = &bitmap.data[(y * width + x) * bitmap.channel_count()];
+  if (bitmap.render_mode == type::FontRenderMode::msdf)
+    return std::max(std::min(texel[0], texel[1]), std::min(std::max(texel[0], texel[1]), texel[2])) / 255.f - 0.5f;
+  return texel[0] / 255.f - 0.5f;
+}
+
+// bilinear sampling at texel position, texel centers are at 0.5
+inline auto sample_distance(graphics_engine::SDFBitmap const& bitmap, float u, float v) -> float
+{
+  u -= 0.5f;
+  v -= 0.5f;
+  auto x  = static_cast<int32_t>(std::floor(u));
+  auto y  = static_cast<int32_t>(std::floor(v));
+  auto fx = u - x;
+  auto fy = v - y;
+  auto top    = std::lerp(get_distance(bitmap, x, y),     get_distance(bitmap, x + 1, y),     fx);
+  auto bottom = std::lerp(get_distance(bitmap, x, y + 1), get_distance(bitmap, x + 1, y + 1), fx);
+  return std::lerp(top, bottom, fy);
+}
+
+/**
+ * mean absolute error of coverage reconstructed from distance field
+ * @param bitmap distance field generated in tier size
+ * @param tier_size pixel size of tier
+ * @param reference coverage rasterized in render size
+ * @param render_size
+ */
+inline auto get_coverage_error(graphics_engine::SDFBitmap const& bitmap, uint32_t tier_size, Coverage const& reference, uint32_t render_size) -> double
+{
+  if (reference.data.empty()) return 0.;
+
+  // distance [-0.5, 0.5] covers twice of spread in tier pixels
+  auto to_tier   = static_cast<float>(tier_size) / render_size;
+  auto to_render = 2.f * graphics_engine::MSDF_Spread / to_tier;
+  double error{};
+  for (int32_t y = 0; y < reference.height; ++y)
+  {
+    for (int32_t x = 0; x < reference.width; ++x)
+    {
+      auto u        = (reference.left + x + 0.5f) * to_tier - bitmap.left_offset;
+      auto v        = (y - reference.top + 0.5f)  * to_tier - bitmap.up_offset;
+      auto coverage = std::clamp(sample_distance(bitmap, u, v) * to_render + 0.5f, 0.f, 1.f);
+      error += std::abs(coverage - reference.data[y * reference.width + x] / 255.f);
+    }
+  }
+  return error / reference.data.size();
+}
+
+// bytes of bitmap in atlas
+inline auto get_atlas_bytes(graphics_engine::SDFBitmap const& bitmap) noexcept -> uint64_t
+{
+  return static_cast<uint64_t>(bitmap.extent.x) * static_cast<uint64_t>(bitmap.extent.y) * bitmap.channel_count();
+}
+
+}}
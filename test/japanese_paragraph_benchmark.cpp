@@ -0,0 +1,86 @@
+//
+// parse_text and parse_paragraph of 10k characters japanese text,
+// every character looks up glyph table when shaping and when checking its glyph is cached
+//
+
+#include "benchmark.hpp"
+
+#include <array>
+#include <format>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr uint32_t Char_Count = 10'000;
+
+// hiragana, katakana, common kanji and punctuation, picked uniformly
+constexpr std::array<std::string_view, 48> Chars
+{
+  "の", "に", "は", "を", "た", "が", "で", "て", "と", "し", "れ", "さ",
+  "あ", "い", "う", "え", "お", "か", "き", "く", "こ", "な", "る", "ま",
+  "ア", "イ", "ス", "ト", "ン", "ー", "ル", "ク",
+  "日", "本", "人", "大", "年", "中", "出", "見", "時", "行", "言", "思",
+  "、", "。", "「", "」",
+};
+
+auto make_text(uint32_t seed)
+{
+  std::mt19937                            rng{ seed };
+  std::uniform_int_distribution<uint32_t> dist{ 0, Chars.size() - 1 };
+  std::string text;
+  for (uint32_t i = 0; i < Char_Count; ++i)
+    text += Chars[dist(rng)];
+  return text;
+}
+
+}
+
+int main()
+{
+  auto& engine = test::init_engine();
+  engine.load_fonts({ test::get_cjk_font_path() }, type::FontRenderMode::sdf);
+  engine.set_glyph_generation_budget(1000.f);
+
+  auto text     = make_text(1);
+  auto per_char = [](double ms) { return std::format("{:.1f} ns/char", ms * 1e6 / Char_Count); };
+
+  // glyphs are generated by first run, later runs hit shaping cache and only look up glyphs
+  auto cached_text = test::measure([&]
+  {
+    engine.parse_text(text, {}, 24.f, type::FontStyle::regular, 0);
+    test::next_frame(engine);
+  });
+
+  // different text every run, every character is shaped and looked up
+  uint32_t seed{ 2 };
+  std::vector<std::string> texts(64);
+  for (auto& t : texts) t = make_text(seed++);
+  uint32_t index{};
+  auto shaped_text = test::measure([&]
+  {
+    engine.parse_text(texts[index++ % texts.size()], {}, 24.f, type::FontStyle::regular, 0);
+    test::next_frame(engine);
+  }, texts.size() - 1, std::chrono::milliseconds{ 0 });
+
+  auto cached_paragraph = test::measure([&]
+  {
+    engine.parse_paragraph(text, {}, 800.f, 24.f, 1.f, type::TextAlign::left, std::numeric_limits<uint32_t>::max(),
+                           type::FontStyle::regular, type::TextDirection::horizontal, 0);
+    test::next_frame(engine);
+  });
+
+  auto frame = test::measure([&] { test::next_frame(engine); });
+
+  test::report("parse_text, cached",      cached_text      - frame, per_char(cached_text      - frame));
+  test::report("parse_text, shaped",      shaped_text      - frame, per_char(shaped_text      - frame));
+  test::report("parse_paragraph, cached", cached_paragraph - frame, per_char(cached_paragraph - frame));
+  test::report("empty frame",             frame);
+
+  tk::destroy();
+}
@@ -0,0 +1,29 @@
+//
+// measured extent of text is same as extent returned by drawing it
+//
+
+#include "test.hpp"
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+int main()
+{
+  auto& engine = test::init_engine();
+  engine.load_fonts({ test::get_font_path() }, type::FontRenderMode::sdf);
+
+  for (auto text : { "A", "Hello, world", "fi fl  ff", "VAVAVA." })
+  {
+    for (auto size : { 12.f, 32.f, 75.f })
+    {
+      auto measured = engine.measure_text(text, size, type::FontStyle::regular);
+      // pen starts anywhere, extent is relative to it
+      auto parsed   = engine.parse_text(text, { 37.f, 11.f }, size, type::FontStyle::regular, 0);
+      TK_EXPECT(measured == parsed);
+    }
+  }
+  engine.get_quads().clear();
+
+  tk::destroy();
+  return test::result();
+}
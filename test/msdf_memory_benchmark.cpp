@@ -0,0 +1,124 @@
+//
+// atlas memory of msdf and sdf at equal quality,
+// msdf has four channels but uses one smaller tier, so it should not use more memory for same quality
+//
+
+#include "glyph_quality.hpp"
+
+#include <array>
+#include <format>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <utf8.h>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr std::array<uint32_t, 4> Render_Sizes{ 24, 48, 96, 192 };
+
+struct Result
+{
+  uint64_t bytes{};
+  double   error{};
+  uint32_t count{};
+
+  void add(SDFBitmap const& bitmap, double bitmap_error) noexcept
+  {
+    bytes += test::get_atlas_bytes(bitmap);
+    error += bitmap_error;
+    ++count;
+  }
+};
+
+void report(std::string_view name, uint32_t size, Result const& result)
+{
+  std::println("{:<32} {:>4} px {:>10.1f} KiB  error {:.4f}", name, size, result.bytes / 1024., result.error / result.count);
+}
+
+// bitmaps of all tiers of glyphs in render mode
+struct TierBitmaps
+{
+  std::vector<uint32_t>                                      min_tiers;
+  std::array<std::vector<SDFBitmap>, TextEngine::Tier_Count> bitmaps;
+};
+
+auto generate(Font& font, std::span<uint32_t const> glyphs)
+{
+  TierBitmaps result;
+  for (auto glyph : glyphs)
+    result.min_tiers.emplace_back(font.get_min_tier(glyph));
+  for (uint32_t tier = 0; tier < TextEngine::Tier_Count; ++tier)
+    for (auto glyph : glyphs)
+      result.bitmaps[tier].emplace_back(font.generate_sdf_bitmap(glyph, tier));
+  return result;
+}
+
+void run(FT_Library ft, std::string_view name, std::string_view path, std::string_view text)
+{
+  std::mutex ft_mutex;
+  auto sdf_font  = Font::create(ft, ft_mutex, path, type::FontRenderMode::sdf);
+  auto msdf_font = Font::create(ft, ft_mutex, path, type::FontRenderMode::msdf);
+  test::ReferenceFace reference{ ft, path };
+
+  std::vector<uint32_t> glyphs;
+  for (auto it = text.begin(); it != text.end();)
+    if (auto glyph = sdf_font.find_glyph(utf8::next(it, text.end())))
+      glyphs.emplace_back(glyph);
+
+  auto sdf  = generate(sdf_font,  glyphs);
+  auto msdf = generate(msdf_font, glyphs);
+
+  for (auto size : Render_Sizes)
+  {
+    auto size_tier = TextEngine::get_size_tier(static_cast<float>(size));
+    Result sdf_selected, msdf_selected, msdf_equal;
+    for (uint32_t i = 0; i < glyphs.size(); ++i)
+    {
+      auto coverage = reference.rasterize(glyphs[i], size);
+      auto get_error = [&](TierBitmaps const& bitmaps, uint32_t tier)
+      {
+        return test::get_coverage_error(bitmaps.bitmaps[tier][i], TextEngine::Tier_Pixel_Sizes[tier], coverage, size);
+      };
+
+      // tiers selected by engine
+      auto sdf_tier  = GlyphEntry{ .min_tier = sdf.min_tiers[i] }.get_tier(size_tier);
+      auto msdf_tier = GlyphEntry{ .min_tier = msdf.min_tiers[i], .msdf = true }.get_tier(size_tier);
+      auto sdf_error = get_error(sdf, sdf_tier);
+      sdf_selected.add(sdf.bitmaps[sdf_tier][i], sdf_error);
+      msdf_selected.add(msdf.bitmaps[msdf_tier][i], get_error(msdf, msdf_tier));
+
+      // smallest msdf tier not worse than selected sdf
+      auto tier = 0u;
+      auto error = get_error(msdf, tier);
+      while (error > sdf_error && tier + 1 < TextEngine::Tier_Count)
+        error = get_error(msdf, ++tier);
+      msdf_equal.add(msdf.bitmaps[tier][i], error);
+    }
+
+    report(std::format("{}, sdf selected",  name), size, sdf_selected);
+    report(std::format("{}, msdf selected", name), size, msdf_selected);
+    report(std::format("{}, msdf equal",    name), size, msdf_equal);
+  }
+
+  sdf_font.destory(ft_mutex);
+  msdf_font.destory(ft_mutex);
+}
+
+}
+
+int main()
+{
+  FT_Library ft;
+  throw_if(FT_Init_FreeType(&ft), "failed to initialize freetype");
+
+  // sharp corners of latin glyphs are where msdf differs, kanji have many of them
+  run(ft, "latin", test::get_font_path(),     "AaBbCcegkMQRSWxyz0123456789@&%");
+  run(ft, "kanji", test::get_cjk_font_path(), "鬱薔薇驚響議籠鑑纏臓龍露鷹麓曜");
+
+  FT_Done_FreeType(ft);
+}
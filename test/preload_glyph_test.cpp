@@ -0,0 +1,40 @@
+//
+// preloaded glyph which is drawn is generated in same frame, not waits preload queue
+//
+
+#include "test.hpp"
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+// uv of first glyph of text
+auto draw_first_uv(GraphicsEngine& engine, std::string_view text)
+{
+  auto& quads = engine.get_quads();
+  engine.parse_text(text, {}, 32.f, type::FontStyle::regular, 0);
+  auto uv = quads.get_batches().back().data[0].uv;
+  quads.clear();
+  return uv;
+}
+
+}
+
+int main()
+{
+  auto& engine = test::init_engine();
+  engine.load_fonts({ test::get_font_path() }, type::FontRenderMode::sdf);
+  // generation of this test never runs out of budget
+  engine.set_glyph_generation_budget(1000.f);
+
+  // private use character is not covered by font, it is drawn by missing glyph
+  auto missing_uv = draw_first_uv(engine, "\xEE\x80\x80");
+
+  // queued by preloading, no frame begins to generate it
+  engine.preload_glyphs("A", type::FontStyle::regular, 32.f);
+  TK_EXPECT(draw_first_uv(engine, "A") != missing_uv);
+
+  tk::destroy();
+  return test::result();
+}
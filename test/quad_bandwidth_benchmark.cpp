@@ -0,0 +1,72 @@
+//
+// write bandwidth of quads, written into frame buffer directly or copied from vectors like before
+//
+
+#include "benchmark.hpp"
+
+#include <cstring>
+#include <format>
+#include <vector>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+// more than a block, so blocks are chained
+constexpr uint32_t Quad_Count = 100'000;
+
+inline void write_quad(Vertex* out, uint32_t i) noexcept
+{
+  auto min = glm::vec2(i % 1024, i / 1024);
+  auto max = min + glm::vec2(8);
+  out[0] = { min,              {}, i };
+  out[1] = { { max.x, min.y }, {}, i };
+  out[2] = { { min.x, max.y }, {}, i };
+  out[3] = { max,              {}, i };
+}
+
+}
+
+int main()
+{
+  auto& engine = test::init_engine();
+  auto& quads  = engine.get_quads();
+  auto  bytes  = static_cast<double>(Quad_Count) * 4 * sizeof(Vertex);
+
+  auto direct = test::measure([&]
+  {
+    for (uint32_t i = 0; i < Quad_Count;)
+    {
+      auto out = quads.add(Quad_Count - i);
+      for (uint32_t j = 0; j < out.size(); j += 4, ++i)
+        write_quad(&out[j], i);
+    }
+    test::next_frame(engine);
+  });
+
+  std::vector<Vertex> vertices;
+  auto copied = test::measure([&]
+  {
+    vertices.clear();
+    vertices.resize(Quad_Count * 4);
+    for (uint32_t i = 0; i < Quad_Count; ++i)
+      write_quad(&vertices[i * 4], i);
+    for (uint32_t i = 0; i < Quad_Count;)
+    {
+      auto out = quads.add(Quad_Count - i);
+      memcpy(out.data(), &vertices[i * 4], out.size_bytes());
+      i += out.size() / 4;
+    }
+    test::next_frame(engine);
+  });
+
+  // cost of empty frame is subtracted
+  auto frame = test::measure([&] { test::next_frame(engine); });
+
+  test::report("write quads directly",        direct - frame, std::format("{:.2f} GiB/s", test::to_gib_per_second(bytes, direct - frame)));
+  test::report("write quads to vector, copy", copied - frame, std::format("{:.2f} GiB/s", test::to_gib_per_second(bytes, copied - frame)));
+  test::report("empty frame",                 frame);
+
+  tk::destroy();
+}
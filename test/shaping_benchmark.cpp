@@ -0,0 +1,88 @@
+//
+// shaping throughput of mixed japanese, english and chinese strings,
+// every string is split into runs by font and script, and runs are shaped by cached shape plans.
+// unique strings are shaped every time, repeated strings hit shaping cache.
+//
+
+#include "benchmark.hpp"
+
+#include <array>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <utf8.h>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr uint32_t Word_Count   = 24;
+constexpr uint32_t String_Count = 2000;
+
+// chinese words only use hanzi also covered by japanese fonts
+constexpr std::array<std::string_view, 12> Japanese_Words{ "日本語", "の", "テキスト", "を", "表示", "します", "ひらがな", "カタカナ", "漢字", "と", "読む", "。" };
+constexpr std::array<std::string_view, 12> English_Words { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "text ", "engine ", "shaping ", "run " };
+constexpr std::array<std::string_view, 12> Chinese_Words { "中文", "文本", "和", "字体", "显示", "我", "是", "学生", "今天", "天气", "很好", "，" };
+
+auto make_string(uint32_t seed)
+{
+  std::mt19937                            rng{ seed };
+  std::uniform_int_distribution<uint32_t> language{ 0, 2 };
+  std::uniform_int_distribution<uint32_t> word{ 0, Japanese_Words.size() - 1 };
+  std::string text;
+  for (uint32_t i = 0; i < Word_Count; ++i)
+  {
+    switch (language(rng))
+    {
+    case 0: text += Japanese_Words[word(rng)]; break;
+    case 1: text += English_Words[word(rng)];  break;
+    case 2: text += Chinese_Words[word(rng)];  break;
+    }
+  }
+  return text;
+}
+
+}
+
+int main()
+{
+  auto& engine = test::init_engine();
+  engine.load_fonts({ test::get_font_path(), test::get_cjk_font_path() }, type::FontRenderMode::sdf);
+
+  // warmup and every run of unique strings shapes its own set, last set is for cached strings
+  constexpr uint32_t Cold_Run_Count = 3;
+  std::vector<std::vector<std::string>> sets(Cold_Run_Count + 2, std::vector<std::string>(String_Count));
+  uint32_t seed{};
+  for (auto& set : sets)
+    for (auto& str : set)
+      str = make_string(seed++);
+  auto& strings = sets.back();
+
+  uint64_t char_count{};
+  for (auto const& str : strings)
+    char_count += utf8::distance(str.begin(), str.end());
+  auto per_char = [&](double ms) { return std::format("{:.1f} ns/char, {:.2f} Mchar/s", ms * 1e6 / char_count, char_count / ms / 1e3); };
+
+  uint32_t index{};
+  auto cold = test::measure([&]
+  {
+    for (auto const& str : sets[index])
+      engine.measure_text(str, 24.f, type::FontStyle::regular);
+    ++index;
+  }, Cold_Run_Count, std::chrono::milliseconds{ 0 });
+
+  // all strings are in shaping cache
+  auto warm = test::measure([&]
+  {
+    for (auto const& str : strings)
+      engine.measure_text(str, 24.f, type::FontStyle::regular);
+  });
+
+  test::report("measure_text, unique strings", cold, per_char(cold));
+  test::report("measure_text, cached strings", warm, per_char(warm));
+
+  tk::destroy();
+}
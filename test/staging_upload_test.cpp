@@ -0,0 +1,72 @@
+//
+// 256 MiB upload is appended to staging blocks by chunks, no big block is created and nothing is copied by growing
+//
+
+#include "test.hpp"
+
+#include <vector>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr uint64_t Upload_Size = 256ull * 1024 * 1024;
+constexpr uint32_t Block_Size  = 16 * 1024 * 1024;
+constexpr uint32_t Row_Size    = 4096 * 4;  // row of 4096 rgba texels
+
+auto get_staging_bytes()
+{
+  return tk::get_memory_stats().categories[static_cast<uint32_t>(type::MemoryCategory::staging)].bytes;
+}
+
+}
+
+int main()
+{
+  auto& engine = test::init_engine();
+
+  StagingBuffer staging;
+  staging.init(&engine.get_memory_allocator(), Block_Size);
+
+  std::vector<std::byte> data(Upload_Size);
+  for (uint64_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<std::byte>(i * 31);
+
+  auto     staging_bytes = get_staging_bytes();
+  uint64_t uploaded{};
+  uint32_t chunk_count{};
+  staging.append_chunks(data.data(), data.size(), Row_Size, 16, [&](StagingRegion region, uint64_t offset, uint32_t size)
+  {
+    TK_EXPECT(region.buffer != VK_NULL_HANDLE);
+    TK_EXPECT(region.offset % 16 == 0);
+    TK_EXPECT(region.offset + size <= Block_Size);
+    TK_EXPECT(size % Row_Size == 0);
+    // chunks are in order and cover whole data
+    TK_EXPECT(offset == uploaded);
+    uploaded += size;
+    ++chunk_count;
+  });
+  TK_EXPECT(uploaded == Upload_Size);
+  TK_EXPECT(chunk_count == Upload_Size / Block_Size);
+
+  // only blocks are allocated, allocation size may be rounded up a little
+  auto added_bytes = get_staging_bytes() - staging_bytes;
+  TK_EXPECT(added_bytes >= Upload_Size && added_bytes < Upload_Size + Block_Size);
+
+  // blocks are reused after frames finished, second upload allocates nothing
+  staging.retire();
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    tk::render();
+    engine.wait_device_complete();
+  }
+  staging.append_chunks(data.data(), data.size(), Row_Size, 16, [](StagingRegion, uint64_t, uint32_t) {});
+  TK_EXPECT(get_staging_bytes() - staging_bytes == added_bytes);
+
+  staging.retire();
+  engine.wait_device_complete();
+  staging.destroy();
+  tk::destroy();
+  return test::result();
+}
@@ -0,0 +1,65 @@
+//
+// test
+//
+// tests link static tk, so they can use internal classes.
+// engine is created with a hidden window, which is shown by first rendered frame.
+// fonts are from system, or from environment variables TK_TEST_FONT and TK_TEST_CJK_FONT.
+//
+
+#pragma once
+
+#include "tk/tk.hpp"
+#include "ui/internal.hpp"
+
+#include <print>
+#include <cstdlib>
+#include <string_view>
+
+// record failure and continue, so all failed checks are printed
+#define TK_EXPECT(x) ::tk::test::expect(x, #x, __FILE__, __LINE__)
+
+namespace tk { namespace test {
+
+inline auto failure_count() noexcept -> int&
+{
+  static int count{};
+  return count;
+}
+
+inline void expect(bool result, std::string_view expr, std::string_view file, int line)
+{
+  if (result) return;
+  ++failure_count();
+  std::println(stderr, "{}:{}: failed: {}", file, line, expr);
+}
+
+// exit code of test
+inline auto result() noexcept
+{
+  return failure_count() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+inline auto get_env(char const* name, std::string_view default_value) -> std::string_view
+{
+  auto value = std::getenv(name);
+  return value ? value : default_value;
+}
+
+inline auto get_font_path() -> std::string_view
+{
+  return get_env("TK_TEST_FONT", "C:/Windows/Fonts/arial.ttf");
+}
+
+inline auto get_cjk_font_path() -> std::string_view
+{
+  return get_env("TK_TEST_CJK_FONT", "C:/Windows/Fonts/msgothic.ttc");
+}
+
+// initialize tk and get its engine, call tk::destroy at end
+inline auto init_engine(uint32_t width = 800, uint32_t height = 600, uint32_t frames_in_flight = 2) -> graphics_engine::GraphicsEngine&
+{
+  tk::init("tk test", width, height, frames_in_flight);
+  return *ui::get_ctx()->engine;
+}
+
+}}
@@ -0,0 +1,102 @@
+//
+// atlas memory and quality of glyph tiers,
+// bitmaps of every tier are compared to freetype rasterization in render sizes,
+// and the tier selected by engine should be close to quality of biggest tier with much less memory
+//
+
+#include "glyph_quality.hpp"
+
+#include <array>
+#include <format>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <utf8.h>
+
+using namespace tk;
+using namespace tk::graphics_engine;
+
+namespace {
+
+constexpr std::array<uint32_t, 4> Render_Sizes{ 24, 48, 96, 192 };
+
+struct GlyphSet
+{
+  std::string_view name;
+  std::string_view path;
+  std::string_view text;
+};
+
+struct Result
+{
+  uint64_t bytes{};
+  double   error{};
+  uint32_t count{};
+};
+
+void report(std::string_view name, uint32_t size, Result const& result)
+{
+  std::println("{:<28} {:>4} px {:>10.1f} KiB  error {:.4f}", name, size, result.bytes / 1024., result.error / result.count);
+}
+
+void run(FT_Library ft, GlyphSet const& set)
+{
+  std::mutex ft_mutex;
+  auto font = Font::create(ft, ft_mutex, set.path, type::FontRenderMode::sdf);
+  test::ReferenceFace reference{ ft, set.path };
+
+  std::vector<uint32_t> glyphs;
+  for (auto it = set.text.begin(); it != set.text.end();)
+    if (auto glyph = font.find_glyph(utf8::next(it, set.text.end())))
+      glyphs.emplace_back(glyph);
+
+  // bitmaps do not depend on render size, generate them once
+  std::array<std::vector<SDFBitmap>, TextEngine::Tier_Count> bitmaps;
+  for (uint32_t tier = 0; tier < TextEngine::Tier_Count; ++tier)
+    for (auto glyph : glyphs)
+      bitmaps[tier].emplace_back(font.generate_sdf_bitmap(glyph, tier));
+
+  for (auto size : Render_Sizes)
+  {
+    std::array<Result, TextEngine::Tier_Count> fixed{};
+    Result selected{};
+    for (uint32_t i = 0; i < glyphs.size(); ++i)
+    {
+      auto coverage = reference.rasterize(glyphs[i], size);
+      for (uint32_t tier = 0; tier < TextEngine::Tier_Count; ++tier)
+      {
+        auto const& bitmap = bitmaps[tier][i];
+        fixed[tier].bytes += test::get_atlas_bytes(bitmap);
+        fixed[tier].error += test::get_coverage_error(bitmap, TextEngine::Tier_Pixel_Sizes[tier], coverage, size);
+        ++fixed[tier].count;
+      }
+
+      GlyphEntry entry{ .min_tier = font.get_min_tier(glyphs[i]) };
+      auto tier = entry.get_tier(TextEngine::get_size_tier(static_cast<float>(size)));
+      selected.bytes += test::get_atlas_bytes(bitmaps[tier][i]);
+      selected.error += test::get_coverage_error(bitmaps[tier][i], TextEngine::Tier_Pixel_Sizes[tier], coverage, size);
+      ++selected.count;
+    }
+
+    for (uint32_t tier = 0; tier < TextEngine::Tier_Count; ++tier)
+      report(std::format("{}, tier {}", set.name, tier), size, fixed[tier]);
+    report(std::format("{}, selected", set.name), size, selected);
+  }
+
+  font.destory(ft_mutex);
+}
+
+}
+
+int main()
+{
+  FT_Library ft;
+  throw_if(FT_Init_FreeType(&ft), "failed to initialize freetype");
+
+  // latin glyphs are simple, kanji have many strokes and points
+  run(ft, { "latin", test::get_font_path(),     "AaBbCcegkMQRSWxyz0123456789@&%" });
+  run(ft, { "kanji", test::get_cjk_font_path(), "鬱薔薇驚響議籠鑑纏臓龍露鷹麓曜" });
+
+  FT_Done_FreeType(ft);
+}